@@ -3,22 +3,27 @@
 #include <cstddef>
 #include <sys/types.h>
 
-Buffer::Buffer(int initBufferSize):buffer_(initBufferSize), 
+template<class Policy>
+BasicBuffer<Policy>::BasicBuffer(int initBufferSize):buffer_(initBufferSize), 
             readPos_(0), writePos_(0) {}
 
-size_t Buffer::WritableBytes() const {
+template<class Policy>
+size_t BasicBuffer<Policy>::WritableBytes() const {
     return buffer_.size() - writePos_;
 }
 
-size_t Buffer::ReadableBytes() const {
+template<class Policy>
+size_t BasicBuffer<Policy>::ReadableBytes() const {
     return writePos_ - readPos_;
 }
 
-size_t Buffer::PrependBytes() const {
+template<class Policy>
+size_t BasicBuffer<Policy>::PrependBytes() const {
     return readPos_;
 }
 
-void Buffer::MakeSpace_(size_t len) {
+template<class Policy>
+void BasicBuffer<Policy>::MakeSpace_(size_t len) {
     // 扩容
     if (WritableBytes() + PrependBytes() < len) {
         buffer_.resize(writePos_ + len + 1);
@@ -33,7 +38,8 @@ void Buffer::MakeSpace_(size_t len) {
     }
 }
 
-void Buffer::EnsureWriteable(size_t len) {
+template<class Policy>
+void BasicBuffer<Policy>::EnsureWriteable(size_t len) {
     // [writePos_, buffer_.size()]容量不够，可以检查[0, readPos_]位置，这是一段已经
     // 被读过的位置，可以让后面的数据位置总体前移
     // readPos_ -> 0, writePos_ -> writePos_ - readPos_
@@ -44,49 +50,94 @@ void Buffer::EnsureWriteable(size_t len) {
     assert(WritableBytes() >= len);
 }
 
-void Buffer::HasWritten(size_t len) {
+template<class Policy>
+void BasicBuffer<Policy>::HasWritten(size_t len) {
     writePos_ += len;
 }
 
-void Buffer::Retrieve(size_t len) {
+template<class Policy>
+void BasicBuffer<Policy>::Retrieve(size_t len) {
     assert(len <= ReadableBytes());
     readPos_ += len;
 }
 
-void Buffer::RetrieveUntil(const char* end) {
+template<class Policy>
+void BasicBuffer<Policy>::RetrieveUntil(const char* end) {
     assert(ReadPtr() <= end);
     Retrieve(end - ReadPtr());
 }
 
-void Buffer::RetrieveAll() {
-    bzero(&buffer_[0], buffer_.size());
+template<class Policy>
+void BasicBuffer<Policy>::RetrieveAll() {
+    // 只重置下标，writePos_ 之后的旧字节不会被读到，不用清零
     readPos_ = 0;
     writePos_ = 0;
 }
 
-std::string Buffer::RetrieveAllToStr() {
+template<class Policy>
+bool BasicBuffer<Policy>::Shrink(size_t highWater, size_t size) {
+    if (ReadableBytes() > 0 || buffer_.size() <= highWater) {
+        return false;
+    }
+    std::vector<char>(size).swap(buffer_);
+    readPos_ = 0;
+    writePos_ = 0;
+    return true;
+}
+
+template<class Policy>
+std::string BasicBuffer<Policy>::RetrieveAllToStr() {
     std::string str(ReadPtr(), ReadableBytes());
     RetrieveAll();
     return str;
 }
 
-void Buffer::Append(const char *str, size_t len) {
+template<class Policy>
+void BasicBuffer<Policy>::Append(const char *str, size_t len) {
     assert(str);
     EnsureWriteable(len);
     std::copy(str, str + len, WritePtr());
     HasWritten(len);
 }
 
-void Buffer::Append(const std::string& str) {
+template<class Policy>
+void BasicBuffer<Policy>::Append(std::string_view str) {
     Append(str.data(), str.length());
 }
 
+/* 每次查表输出两位数字，从低位往高位写进栈上的临时数组 */
+template<class Policy>
+void BasicBuffer<Policy>::AppendDecimal(uint64_t n) {
+    static const char DIGITS[] =
+        "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+        "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+    char buf[20];
+    char* p = buf + sizeof(buf);
+    while (n >= 100) {
+        const char* d = DIGITS + (n % 100) * 2;
+        n /= 100;
+        *--p = d[1];
+        *--p = d[0];
+    }
+    if (n >= 10) {
+        const char* d = DIGITS + n * 2;
+        *--p = d[1];
+        *--p = d[0];
+    }
+    else {
+        *--p = static_cast<char>('0' + n);
+    }
+    Append(p, buf + sizeof(buf) - p);
+}
+
 /*
 最大程度减少系统调用（read）的次数：
 构造两个 iovec -> iovec[0] 指向buffer的空闲区域 -> iovec[1] 指向一个临时分配的栈上数组 ->
 readv 读取 fd（只需调用一次readv） -> 数据读入iovec -> iovec[1] 合并到 buffer 中
 */
-ssize_t Buffer::ReadFd(int fd, int* Errno) {
+template<class Policy>
+ssize_t BasicBuffer<Policy>::ReadFd(int fd, int* Errno) {
     char temp_buf[65535];
     struct iovec iov[2];
     const size_t writeable = WritableBytes();
@@ -111,7 +162,8 @@ ssize_t Buffer::ReadFd(int fd, int* Errno) {
     return len;
 }
 
-ssize_t Buffer::WriteFd(int fd, int* Errno) {
+template<class Policy>
+ssize_t BasicBuffer<Policy>::WriteFd(int fd, int* Errno) {
     ssize_t readable = ReadableBytes();
     ssize_t len = write(fd, ReadPtr(), readable);
     if (len < 0) {
@@ -120,4 +172,7 @@ ssize_t Buffer::WriteFd(int fd, int* Errno) {
     }
     readPos_ += len;
     return len;
-}
\ No newline at end of file
+}
+
+template class BasicBuffer<SingleOwner>;
+template class BasicBuffer<Synchronized>;
@@ -1,6 +1,8 @@
 #pragma once
 #include <cstddef>
 #include <cstring>   //perror
+#include <cstdint>
+#include <string_view>
 #include <iostream>
 #include <sys/types.h>
 #include <unistd.h>  // write
@@ -9,15 +11,29 @@
 #include <atomic>
 #include <assert.h>
 
-class Buffer {
+/*
+下标的同步策略：
+SingleOwner   普通 size_t，缓冲区只由一个线程使用，或由调用方的锁保护(HttpConn、Log)
+Synchronized  std::atomic<size_t>，单个下标的读写是原子的，供确实跨线程读取长度的调用方使用
+*/
+struct SingleOwner {
+    typedef std::size_t Index;
+};
+
+struct Synchronized {
+    typedef std::atomic<std::size_t> Index;
+};
+
+template<class Policy>
+class BasicBuffer {
 /*
 | 预留空间 (Prepend) |  已读数据 (Readable)  |  可写空间 (Writable)  |
 ^                    ^                       ^                       ^
 0                 readPos_                writePos_             size()
 */
 public:
-    Buffer(int initBufferSize = 1024);
-    ~Buffer() = default;
+    BasicBuffer(int initBufferSize = 1024);
+    ~BasicBuffer() = default;
 
     size_t WritableBytes() const;
     size_t ReadableBytes() const;
@@ -35,8 +51,12 @@ public:
     void RetrieveAll();
     std::string RetrieveAllToStr();
 
+    // 没有可读数据且容量超过 highWater 时缩回 size 字节，释放偶发大响应撑大的空间
+    bool Shrink(size_t highWater, size_t size);
+
     void Append(const char* str, size_t len);
-    void Append(const std::string& str);
+    void Append(std::string_view str);
+    void AppendDecimal(uint64_t n);     // 十进制格式化后直接写入，不经过 std::to_string
 
     ssize_t ReadFd(int fd, int* Errno);
     ssize_t WriteFd(int fd, int* Errno);
@@ -49,7 +69,10 @@ private:
     void MakeSpace_(size_t len);
 
     std::vector<char> buffer_;
-    // atomic 保证线程安全的pos参数访问
-    std::atomic<std::size_t> readPos_;
-    std::atomic<std::size_t> writePos_;
-};
\ No newline at end of file
+    typename Policy::Index readPos_;
+    typename Policy::Index writePos_;
+};
+
+// 实现在 buffer.cpp，两种策略在那里显式实例化
+typedef BasicBuffer<SingleOwner> Buffer;
+typedef BasicBuffer<Synchronized> SyncBuffer;
\ No newline at end of file
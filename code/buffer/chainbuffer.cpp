@@ -0,0 +1,313 @@
+#include "chainbuffer.h"
+#include <cerrno>
+#include <algorithm>
+#include <assert.h>
+#include <limits.h>  // IOV_MAX
+#include <unistd.h>
+#include <sys/mman.h>
+
+BlockPool::BlockPool(): hugePages_(false), maxFree_(DEFAULT_MAX_FREE), total_(0), cached_(0) {}
+
+BlockPool::~BlockPool() {
+    std::lock_guard<std::mutex> locker(mtx_);
+    // 大页分配失败时会混入 new 出来的块，只有它们需要 delete[]
+    for (char* block : free_) {
+        if (!InSlab_(block)) {
+            delete[] block;
+        }
+    }
+    for (auto& slab : slabs_) {
+        munmap(slab.first, slab.second);
+    }
+}
+
+BlockPool* BlockPool::Instance() {
+    static BlockPool pool;
+    return &pool;
+}
+
+/* 应在分配任何块之前调用 */
+void BlockPool::init(bool hugePages, size_t maxFree) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    assert(total_ == 0 || hugePages == hugePages_);
+    hugePages_ = hugePages;
+    maxFree_ = maxFree;
+}
+
+BlockPool::LocalCache::~LocalCache() {
+    BlockPool::Instance()->Drain_(blocks, blocks.size());
+}
+
+BlockPool::LocalCache& BlockPool::Local_() {
+    static thread_local LocalCache cache;
+    return cache;
+}
+
+char* BlockPool::Get() {
+    std::vector<char*>& blocks = Local_().blocks;
+    if (blocks.empty()) {
+        Refill_(blocks);
+    }
+    char* block = blocks.back();
+    blocks.pop_back();
+    cached_--;
+    return block;
+}
+
+void BlockPool::Put(char* block) {
+    std::vector<char*>& blocks = Local_().blocks;
+    blocks.push_back(block);
+    cached_++;
+    if (blocks.size() > LOCAL_MAX) {
+        Drain_(blocks, BATCH);
+    }
+}
+
+/* 从全局空闲表取一批块到本线程缓存，不够时分配新块 */
+void BlockPool::Refill_(std::vector<char*>& blocks) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    if (free_.empty() && hugePages_) {
+        AllocSlab_();
+    }
+    size_t n = std::min(BATCH, free_.size());
+    blocks.insert(blocks.end(), free_.end() - n, free_.end());
+    free_.resize(free_.size() - n);
+    for (; n < BATCH; n++) {
+        blocks.push_back(new char[BLOCK_SIZE]);
+        total_++;
+    }
+    cached_ += BATCH;
+}
+
+/* 本线程缓存末尾的 count 个块还给全局空闲表，超过 maxFree_ 的部分释放 */
+void BlockPool::Drain_(std::vector<char*>& blocks, size_t count) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    cached_ -= count;
+    for (size_t i = 0; i < count; i++) {
+        char* block = blocks.back();
+        blocks.pop_back();
+        if (free_.size() < maxFree_ || (hugePages_ && InSlab_(block))) {
+            free_.push_back(block);
+        }
+        else {
+            delete[] block;
+            total_--;
+        }
+    }
+}
+
+/* 调用方持有 mtx_ */
+void BlockPool::AllocSlab_() {
+    void* addr = mmap(nullptr, SLAB_SIZE, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (addr == MAP_FAILED) {
+        // 没有预留大页时退回普通映射，请求内核用透明大页
+        addr = mmap(nullptr, SLAB_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (addr == MAP_FAILED) { return; }
+        madvise(addr, SLAB_SIZE, MADV_HUGEPAGE);
+    }
+    slabs_.emplace_back(static_cast<char*>(addr), SLAB_SIZE);
+    for (size_t off = 0; off + BLOCK_SIZE <= SLAB_SIZE; off += BLOCK_SIZE) {
+        free_.push_back(static_cast<char*>(addr) + off);
+        total_++;
+    }
+}
+
+/* 调用方持有 mtx_；片数很少，线性查找 */
+bool BlockPool::InSlab_(const char* block) const {
+    for (auto& slab : slabs_) {
+        if (block >= slab.first && block < slab.first + slab.second) {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t BlockPool::FreeBlocks() {
+    std::lock_guard<std::mutex> locker(mtx_);
+    return free_.size() + cached_;
+}
+
+size_t BlockPool::TotalBlocks() {
+    return total_;
+}
+
+ChainBuffer::~ChainBuffer() {
+    RetrieveAll();
+}
+
+ChainBuffer::Block ChainBuffer::NewBlock_(size_t cap) {
+    char* data = cap == BlockPool::BLOCK_SIZE ? BlockPool::Instance()->Get() : new char[cap];
+    return {data, cap, 0, 0};
+}
+
+void ChainBuffer::Release_(Block& block) {
+    if (block.cap == BlockPool::BLOCK_SIZE) {
+        BlockPool::Instance()->Put(block.data);
+    }
+    else {
+        delete[] block.data;
+    }
+    block.data = nullptr;
+}
+
+void ChainBuffer::Append(const char* str, size_t len) {
+    assert(str || len == 0);
+    readable_ += len;
+    while (len > 0) {
+        if (blocks_.empty() || blocks_.back().writePos == blocks_.back().cap) {
+            blocks_.push_back(NewBlock_(BlockPool::BLOCK_SIZE));
+        }
+        Block& tail = blocks_.back();
+        size_t n = std::min(len, tail.cap - tail.writePos);
+        std::copy(str, str + n, tail.data + tail.writePos);
+        tail.writePos += n;
+        str += n;
+        len -= n;
+    }
+}
+
+void ChainBuffer::Append(std::string_view str) {
+    Append(str.data(), str.length());
+}
+
+char* ChainBuffer::AppendBlock(char* block, size_t len) {
+    assert(block && len <= BlockPool::BLOCK_SIZE);
+    if (!blocks_.empty() && blocks_.back().cap - blocks_.back().writePos >= len) {
+        Append(block, len);
+        return block;
+    }
+    blocks_.push_back({block, BlockPool::BLOCK_SIZE, 0, len});
+    readable_ += len;
+    return nullptr;
+}
+
+/* 读完的块还给池；最后一块读完也还回去，空闲连接不占用块 */
+void ChainBuffer::Retrieve(size_t len) {
+    assert(len <= readable_);
+    readable_ -= len;
+    size_t done = 0;
+    while (len > 0) {
+        Block& block = blocks_[done];
+        size_t n = std::min(len, block.writePos - block.readPos);
+        block.readPos += n;
+        len -= n;
+        if (block.readPos == block.writePos) {
+            Release_(block);
+            done++;
+        }
+    }
+    blocks_.erase(blocks_.begin(), blocks_.begin() + done);
+}
+
+void ChainBuffer::RetrieveAll() {
+    for (Block& block : blocks_) {
+        Release_(block);
+    }
+    blocks_.clear();
+    readable_ = 0;
+}
+
+std::string ChainBuffer::RetrieveAllToStr() {
+    std::string str;
+    str.reserve(readable_);
+    for (const Block& block : blocks_) {
+        str.append(block.data + block.readPos, block.writePos - block.readPos);
+    }
+    RetrieveAll();
+    return str;
+}
+
+/*
+可读数据在一个块内时直接返回，不拷贝；
+跨块时合并到新块，容量取可读字节数的两倍，之后的 readv 先填这个块的剩余空间，
+同一个请求分多次到达时拷贝总量与请求长度成线性关系
+*/
+std::string_view ChainBuffer::Pullup() {
+    if (blocks_.empty()) {
+        return {};
+    }
+    if (blocks_.size() > 1) {
+        size_t cap = readable_ < BlockPool::BLOCK_SIZE ? BlockPool::BLOCK_SIZE : readable_ * 2;
+        Block merged = NewBlock_(cap);
+        for (Block& block : blocks_) {
+            std::copy(block.data + block.readPos, block.data + block.writePos, merged.data + merged.writePos);
+            merged.writePos += block.writePos - block.readPos;
+            Release_(block);
+        }
+        blocks_.clear();
+        blocks_.push_back(merged);
+    }
+    const Block& head = blocks_.front();
+    return {head.data + head.readPos, head.writePos - head.readPos};
+}
+
+int ChainBuffer::ReadIov(struct iovec* iov, int max) const {
+    int cnt = 0;
+    for (const Block& block : blocks_) {
+        if (cnt >= max) { break; }
+        iov[cnt].iov_base = block.data + block.readPos;
+        iov[cnt].iov_len = block.writePos - block.readPos;
+        cnt++;
+    }
+    return cnt;
+}
+
+/*
+尾块剩余空间 + READ_BLOCKS 个池中的块，一次 readv；
+数据落在哪些新块里就把哪些挂到链尾，没用上的立即还给池
+*/
+ssize_t ChainBuffer::ReadFd(int fd, int* Errno) {
+    struct iovec iov[READ_BLOCKS + 1];
+    Block fresh[READ_BLOCKS];
+    int cnt = 0;
+    size_t tailFree = 0;
+    if (!blocks_.empty() && blocks_.back().writePos < blocks_.back().cap) {
+        Block& tail = blocks_.back();
+        tailFree = tail.cap - tail.writePos;
+        iov[cnt].iov_base = tail.data + tail.writePos;
+        iov[cnt].iov_len = tailFree;
+        cnt++;
+    }
+    for (int i = 0; i < READ_BLOCKS; i++) {
+        fresh[i] = NewBlock_(BlockPool::BLOCK_SIZE);
+        iov[cnt].iov_base = fresh[i].data;
+        iov[cnt].iov_len = fresh[i].cap;
+        cnt++;
+    }
+
+    /* 分散读 */
+    const ssize_t len = readv(fd, iov, cnt);
+    if (len < 0) {
+        *Errno = errno;
+    }
+    size_t left = len > 0 ? len : 0;
+    readable_ += left;
+    if (tailFree > 0) {
+        size_t n = std::min(left, tailFree);
+        blocks_.back().writePos += n;
+        left -= n;
+    }
+    for (int i = 0; i < READ_BLOCKS; i++) {
+        if (left == 0) {
+            Release_(fresh[i]);
+            continue;
+        }
+        fresh[i].writePos = std::min(left, fresh[i].cap);
+        left -= fresh[i].writePos;
+        blocks_.push_back(fresh[i]);
+    }
+    return len;
+}
+
+ssize_t ChainBuffer::WriteFd(int fd, int* Errno) {
+    struct iovec iov[IOV_MAX];
+    int cnt = ReadIov(iov, IOV_MAX);
+    ssize_t len = writev(fd, iov, cnt);
+    if (len < 0) {
+        *Errno = errno;
+        return len;
+    }
+    Retrieve(len);
+    return len;
+}
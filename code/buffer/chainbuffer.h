@@ -0,0 +1,117 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <sys/types.h>
+#include <sys/uio.h> //readv/writev
+
+/*
+定长内存块池：ChainBuffer 的块都从这里取、用完还回来，块本身不随连接常驻。
+
+- 每个线程有自己的空闲块缓存，Get/Put 通常不加锁；缓存超过 LOCAL_MAX 时成批还给全局空闲表，
+  空了再从全局成批取 BATCH 个
+- 全局空闲表超过 maxFree 时多出的块直接释放，突发流量过后内存还给系统
+- hugePages 模式下按 2MB 大页(MAP_HUGETLB，失败时退回透明大页)成片分配，减少 TLB 缺失；
+  大页上的块只在池内循环，不释放；大页分配失败时补上的普通块仍按 maxFree 释放
+*/
+class BlockPool {
+public:
+    static BlockPool* Instance();
+
+    void init(bool hugePages = false, size_t maxFree = DEFAULT_MAX_FREE);
+
+    char* Get();
+    void Put(char* block);
+
+    size_t FreeBlocks();        // 空闲的块数(全局空闲表 + 各线程缓存)
+    size_t TotalBlocks();       // 已分配的块总数(空闲 + 使用中)
+
+    static constexpr size_t BLOCK_SIZE = 16 * 1024;
+    static constexpr size_t LOCAL_MAX = 32;
+    static constexpr size_t BATCH = 16;
+    static constexpr size_t DEFAULT_MAX_FREE = 1024;
+    static constexpr size_t SLAB_SIZE = 2 * 1024 * 1024;
+
+private:
+    BlockPool();
+    ~BlockPool();
+
+    struct LocalCache {
+        std::vector<char*> blocks;
+        ~LocalCache();
+    };
+    static LocalCache& Local_();
+
+    void Refill_(std::vector<char*>& blocks);
+    void Drain_(std::vector<char*>& blocks, size_t count);
+    void AllocSlab_();
+    bool InSlab_(const char* block) const;
+
+    std::mutex mtx_;
+    std::vector<char*> free_;
+    std::vector<std::pair<char*, size_t>> slabs_;   // 大页模式下 mmap 的整片内存
+    bool hugePages_;
+    size_t maxFree_;
+    std::atomic<size_t> total_;
+    std::atomic<size_t> cached_;    // 各线程缓存中的块数
+};
+
+/*
+由定长块串成的缓冲区：
+| 块0: 已读 | 可读 |  ->  | 块1: 可读 |  ->  | 块2: 可读 | 可写 |
+- ReadFd 把尾块的剩余空间和若干个池中的空闲块一起交给 readv，数据直接落到块里，不经过栈上数组再拷贝
+- Retrieve 读完的块立即还给 BlockPool，没有可读数据时一个块也不持有；不搬移、不扩容
+- ReadIov 以 iovec 形式给出可读数据，writev 直接使用
+- 解析器需要连续内存时用 Pullup：只有可读数据跨块时才拷贝到一个足够大的块里
+*/
+class ChainBuffer {
+public:
+    ChainBuffer() = default;
+    ~ChainBuffer();
+    ChainBuffer(const ChainBuffer&) = delete;
+    ChainBuffer& operator=(const ChainBuffer&) = delete;
+
+    size_t ReadableBytes() const { return readable_; }
+    size_t BlockCount() const { return blocks_.size(); }
+
+    void Append(const char* str, size_t len);
+    void Append(std::string_view str);
+
+    /*
+    接管一个已装有 len 字节数据的 BlockPool 块(io_uring 从缓冲区环选用的块)，挂到链尾不拷贝。
+    尾块放得下时改为拷进尾块，块原样返回给调用方继续使用；接管时返回 nullptr
+    */
+    char* AppendBlock(char* block, size_t len);
+
+    void Retrieve(size_t len);
+    void RetrieveAll();
+    std::string RetrieveAllToStr();
+
+    // 把所有可读数据合并为一段连续内存，视图在下一次修改缓冲区之前有效
+    std::string_view Pullup();
+
+    // 可读数据按块填入 iov，最多 max 个，返回填入的个数
+    int ReadIov(struct iovec* iov, int max) const;
+
+    ssize_t ReadFd(int fd, int* Errno);
+    ssize_t WriteFd(int fd, int* Errno);
+
+    static const int READ_BLOCKS = 4;   // 每次 readv 最多新取的块数，与尾块剩余空间合计约 64KB
+
+private:
+    struct Block {
+        char* data;
+        size_t cap;         // BLOCK_SIZE 的块来自 BlockPool，更大的由 Pullup 单独分配
+        size_t readPos;
+        size_t writePos;
+    };
+
+    static Block NewBlock_(size_t cap);
+    static void Release_(Block& block);
+
+    std::vector<Block> blocks_;
+    size_t readable_ = 0;
+};
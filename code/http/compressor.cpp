@@ -0,0 +1,88 @@
+#include "compressor.h"
+
+#include <time.h>
+#include <zlib.h>
+
+Compressor::Compressor(): isClose_(true), jobs_(0), bytesIn_(0), bytesOut_(0), cpuNs_(0) {}
+
+Compressor::~Compressor() {
+    close();
+}
+
+Compressor* Compressor::Instance() {
+    static Compressor compressor;
+    return &compressor;
+}
+
+void Compressor::init() {
+    std::lock_guard<std::mutex> locker(mtx_);
+    if (!isClose_) { return; }
+    isClose_ = false;
+    worker_ = std::thread(&Compressor::loop_, this);
+}
+
+void Compressor::close() {
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        isClose_ = true;
+        queue_.clear();
+    }
+    cond_.notify_all();
+    if (worker_.joinable()) { worker_.join(); }
+    pending_.clear();
+}
+
+bool Compressor::submit(const std::string& key, std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        if (isClose_ || queue_.size() >= MAX_QUEUE || !pending_.insert(key).second) {
+            return false;
+        }
+        queue_.emplace_back(key, std::move(job));
+    }
+    cond_.notify_one();
+    return true;
+}
+
+void Compressor::loop_() {
+    std::unique_lock<std::mutex> locker(mtx_);
+    while (true) {
+        cond_.wait(locker, [this]() { return isClose_ || !queue_.empty(); });
+        if (isClose_) { break; }
+        auto item = std::move(queue_.front());
+        queue_.pop_front();
+        locker.unlock();
+
+        struct timespec begin, end;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &begin);
+        item.second();
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &end);
+        cpuNs_ += (end.tv_sec - begin.tv_sec) * 1000000000LL + (end.tv_nsec - begin.tv_nsec);
+        jobs_++;
+
+        locker.lock();
+        pending_.erase(item.first);
+    }
+}
+
+bool Compressor::gzip(std::string_view in, std::string& out, int level) {
+    z_stream zs = {};
+    // windowBits 15 + 16 输出 gzip 头尾而不是 zlib 格式
+    if (deflateInit2(&zs, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+    out.resize(deflateBound(&zs, in.size()));
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+    zs.avail_in = in.size();
+    zs.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    zs.avail_out = out.size();
+    int ret = deflate(&zs, Z_FINISH);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    if (ret != Z_STREAM_END) { return false; }
+
+    Compressor* compressor = Instance();
+    compressor->bytesIn_ += in.size();
+    compressor->bytesOut_ += out.size();
+    return true;
+}
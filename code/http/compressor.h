@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+#include <unordered_set>
+
+/*
+后台压缩：请求路径上只提交任务，由单独的线程完成 gzip 压缩并把结果放入 ContentCache，
+之后的请求直接发送缓存的压缩结果，请求路径上不花 CPU 在压缩上。
+
+- 同一 key 在排队/执行期间只接受一次提交
+- 队列满时拒绝提交，调用方照常发送未压缩的内容
+*/
+class Compressor {
+public:
+    static Compressor* Instance();
+
+    void init();
+    void close();
+
+    // 提交压缩任务，未启动、重复或队列已满时返回 false
+    bool submit(const std::string& key, std::function<void()> job);
+
+    // zlib 的 gzip 格式压缩，压缩前后的字节数计入统计
+    static bool gzip(std::string_view in, std::string& out, int level = 6);
+
+    uint64_t jobs() const { return jobs_; }
+    uint64_t bytesIn() const { return bytesIn_; }
+    uint64_t bytesOut() const { return bytesOut_; }
+    uint64_t cpuNs() const { return cpuNs_; }     // 压缩线程累计 CPU 时间
+
+    static const size_t MAX_QUEUE = 256;
+
+private:
+    Compressor();
+    ~Compressor();
+
+    void loop_();
+
+    std::mutex mtx_;
+    std::condition_variable cond_;
+    std::deque<std::pair<std::string, std::function<void()>>> queue_;
+    std::unordered_set<std::string> pending_;   // 排队或执行中的 key
+    bool isClose_;
+    std::thread worker_;
+
+    std::atomic<uint64_t> jobs_;
+    std::atomic<uint64_t> bytesIn_;
+    std::atomic<uint64_t> bytesOut_;
+    std::atomic<uint64_t> cpuNs_;
+};
@@ -0,0 +1,84 @@
+#include "contentcache.h"
+
+#include <unistd.h>
+#include <errno.h>
+
+ContentCache::ContentCache(): budget_(0), bytes_(0),
+        hits_(0), misses_(0), evictions_(0) {}
+
+ContentCache* ContentCache::Instance() {
+    static ContentCache cache;
+    return &cache;
+}
+
+void ContentCache::init(size_t budget) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    budget_ = budget;
+    lru_.clear();
+    index_.clear();
+    bytes_ = 0;
+}
+
+ContentCache::BlobPtr ContentCache::get(const std::string& path,
+        const FileCache::EntryPtr& source, int code, const FileCache::EntryPtr& variant) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    auto it = index_.find(path);
+    if (it == index_.end() || it->second->blob->source != source ||
+            it->second->blob->code != code || it->second->blob->variant != variant) {
+        misses_++;
+        return nullptr;
+    }
+    hits_++;
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return it->second->blob;
+}
+
+ContentCache::BlobPtr ContentCache::put(const std::string& path, Blob&& blob) {
+    BlobPtr ptr = std::make_shared<const Blob>(std::move(blob));
+    size_t size = ptr->size();
+    if (size > budget_) { return ptr; }
+
+    std::lock_guard<std::mutex> locker(mtx_);
+    auto it = index_.find(path);
+    if (it != index_.end()) {
+        // 文件已变化(或状态码不同)，替换旧 Blob；正在发送旧 Blob 的响应不受影响
+        bytes_ -= it->second->blob->size();
+        it->second->blob = ptr;
+        lru_.splice(lru_.begin(), lru_, it->second);
+    }
+    else {
+        lru_.push_front({path, ptr});
+        index_.emplace(path, lru_.begin());
+    }
+    bytes_ += size;
+    while (bytes_ > budget_) {
+        Node& victim = lru_.back();
+        bytes_ -= victim.blob->size();
+        index_.erase(victim.path);
+        lru_.pop_back();
+        evictions_++;
+    }
+    return ptr;
+}
+
+bool ContentCache::readFile(const FileCache::Entry& entry, std::string& out) {
+    out.resize(entry.st.st_size);
+    size_t done = 0;
+    while (done < out.size()) {
+        ssize_t n = pread(entry.fd, &out[done], out.size() - done, done);
+        if (n < 0 && errno == EINTR) { continue; }
+        if (n <= 0) { return false; }   // 读取出错或文件在 stat 之后被截断
+        done += n;
+    }
+    return true;
+}
+
+size_t ContentCache::bytes() {
+    std::lock_guard<std::mutex> locker(mtx_);
+    return bytes_;
+}
+
+size_t ContentCache::count() {
+    std::lock_guard<std::mutex> locker(mtx_);
+    return lru_.size();
+}
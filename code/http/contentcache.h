@@ -0,0 +1,77 @@
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <atomic>
+#include <unordered_map>
+
+#include "filecache.h"
+
+/*
+小文件热点内容缓存：把小于 MAX_OBJECT 的文件内容连同预生成的响应头(状态行、Content-type、Content-length)
+存成不可变的 Blob，多个响应通过 shared_ptr 共享同一份内存，直接作为 iovec 发送，不拷贝也不 mmap。
+
+- 按字节预算做 LRU 淘汰，预算 <= 0 时关闭。
+- Blob 记录生成时的 FileCache 条目，文件变化后 FileCache 给出新条目，对不上即视为未命中并重建。
+*/
+class ContentCache {
+public:
+    struct Blob {
+        FileCache::EntryPtr source;     // 生成时的文件缓存条目
+        FileCache::EntryPtr variant;    // gzip 变体取自的 .gz 兄弟文件条目，后台压缩生成的与其余 Blob 为空
+        int code = 200;
+        std::string head;   // 状态行 + Content-type 等 + Content-length，不含结尾空行；为空表示不值得压缩
+        std::string body;
+
+        size_t size() const { return sizeof(Blob) + head.size() + body.size(); }
+    };
+    typedef std::shared_ptr<const Blob> BlobPtr;
+
+    static ContentCache* Instance();
+
+    void init(size_t budget);
+
+    bool enabled() const { return budget_ > 0; }
+
+    // 只缓存小文件，更大的文件仍由 FileCache 映射或 sendfile 发送
+    static bool cacheable(size_t fileSize) { return fileSize < MAX_OBJECT; }
+
+    // 命中且与 source/code/variant 一致时返回 Blob，否则返回空
+    BlobPtr get(const std::string& path, const FileCache::EntryPtr& source, int code,
+            const FileCache::EntryPtr& variant = nullptr);
+
+    // 放入缓存(超过预算时淘汰最久未用的)，返回共享的 Blob；单个 Blob 超过预算时只返回不缓存
+    BlobPtr put(const std::string& path, Blob&& blob);
+
+    // 从缓存条目的 fd 读出整个文件
+    static bool readFile(const FileCache::Entry& entry, std::string& out);
+
+    uint64_t hits() const { return hits_; }
+    uint64_t misses() const { return misses_; }
+    uint64_t evictions() const { return evictions_; }
+    size_t bytes();
+    size_t count();
+
+    static const size_t MAX_OBJECT = 64 * 1024;
+
+private:
+    ContentCache();
+    ~ContentCache() = default;
+
+    struct Node {
+        std::string path;
+        BlobPtr blob;
+    };
+
+    std::mutex mtx_;
+    std::list<Node> lru_;   // 表头为最近使用
+    std::unordered_map<std::string, std::list<Node>::iterator> index_;
+    size_t budget_;
+    size_t bytes_;
+
+    std::atomic<uint64_t> hits_;
+    std::atomic<uint64_t> misses_;
+    std::atomic<uint64_t> evictions_;
+};
@@ -0,0 +1,228 @@
+#include "filecache.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/inotify.h>
+#include <time.h>
+
+static const uint32_t WATCH_MASK = IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE |
+        IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+        IN_DELETE_SELF | IN_MOVE_SELF;
+
+FileCache::Entry::~Entry() {
+    if (addr) { munmap(addr, st.st_size); }
+    if (fd >= 0) { ::close(fd); }
+}
+
+FileCache::FileCache(): mapMin_(0), mapLimit_(SIZE_MAX), version_(0), negatives_(0), inotifyFd_(-1),
+        isClose_(true), hits_(0), misses_(0), loads_(0) {}
+
+FileCache::~FileCache() {
+    close();
+}
+
+FileCache* FileCache::Instance() {
+    static FileCache cache;
+    return &cache;
+}
+
+void FileCache::init(const std::string& srcDir, size_t mapMin, size_t mapLimit) {
+    close();
+    srcDir_ = srcDir;
+    mapMin_ = mapMin;
+    mapLimit_ = mapLimit;
+    isClose_ = false;
+    inotifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd_ < 0 || !watch_("")) {
+        // 没有 inotify 时无法感知文件变化，宁可不缓存
+        LOG_WARN("FileCache: inotify unavailable, caching disabled");
+        if (inotifyFd_ >= 0) { ::close(inotifyFd_); }
+        inotifyFd_ = -1;
+        return;
+    }
+    watcher_ = std::thread(&FileCache::watchLoop_, this);
+    LOG_INFO("FileCache: watching %s (%d dirs), mmap range:[%zu, %zu)", srcDir_.c_str(),
+            (int)wdDirs_.size(), mapMin_, mapLimit_);
+}
+
+void FileCache::close() {
+    isClose_ = true;
+    if (watcher_.joinable()) { watcher_.join(); }
+    if (inotifyFd_ >= 0) {
+        ::close(inotifyFd_);
+        inotifyFd_ = -1;
+    }
+    wdDirs_.clear();
+    invalidateAll_();
+}
+
+FileCache::EntryPtr FileCache::get(const std::string& path, bool derived) {
+    if (inotifyFd_ < 0) {
+        return load_(path);
+    }
+
+    std::optional<std::promise<EntryPtr>> promise;  // 只在未命中时创建共享状态，命中路径不分配内存
+    uint64_t version;
+    {
+        std::unique_lock<std::mutex> locker(mtx_);
+        auto it = cache_.find(path);
+        if (it != cache_.end()) {
+            hits_++;
+            return it->second;
+        }
+        misses_++;
+        auto loading = loading_.find(path);
+        if (loading != loading_.end()) {
+            // 已有线程在加载同一路径，等它的结果
+            std::shared_future<EntryPtr> future = loading->second;
+            locker.unlock();
+            return future.get();
+        }
+        promise.emplace();
+        loading_.emplace(path, promise->get_future().share());
+        version = version_;
+    }
+
+    loads_++;
+    EntryPtr entry = load_(path);
+    promise->set_value(entry);
+
+    std::lock_guard<std::mutex> locker(mtx_);
+    loading_.erase(path);
+    if (version == version_) {
+        // 负缓存单独限额：扫描随机 URL 时不会把热点文件挤出缓存
+        if (entry->err && !derived && negatives_ >= MAX_NEGATIVE) {
+            return entry;
+        }
+        if (cache_.size() >= MAX_ENTRIES) {
+            erase_(cache_.begin());
+        }
+        negatives_ += entry->err ? 1 : 0;
+        cache_.emplace(path, entry);
+    }
+    return entry;
+}
+
+FileCache::EntryPtr FileCache::load_(const std::string& path) const {
+    auto entry = std::make_shared<Entry>();
+    std::string file = srcDir_ + path;
+    if (stat(file.data(), &entry->st) < 0) {
+        entry->err = errno;
+        return entry;
+    }
+    // 目录、无读权限的文件只需要 stat 结果
+    if (!S_ISREG(entry->st.st_mode) || !(entry->st.st_mode & S_IROTH)) {
+        return entry;
+    }
+    entry->fd = open(file.data(), O_RDONLY | O_CLOEXEC);
+    if (entry->fd < 0) {
+        entry->err = errno;
+        return entry;
+    }
+    // 校验值在加载时生成一次，之后的请求直接使用
+    char buf[64];
+    int len = snprintf(buf, sizeof(buf), "\"%llx-%llx\"",
+            (unsigned long long)entry->st.st_mtime, (unsigned long long)entry->st.st_size);
+    entry->etag.assign(buf, len);
+    struct tm tm;
+    gmtime_r(&entry->st.st_mtime, &tm);
+    entry->lastModified.assign(buf, strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tm));
+
+    size_t size = entry->st.st_size;
+    if (size > 0 && size >= mapMin_ && size < mapLimit_) {
+        void* addr = mmap(nullptr, entry->st.st_size, PROT_READ, MAP_SHARED, entry->fd, 0);
+        if (addr == MAP_FAILED) {
+            entry->err = errno;
+            return entry;
+        }
+        entry->addr = static_cast<char*>(addr);
+    }
+    return entry;
+}
+
+/* 递归监听 relDir 及其子目录 */
+bool FileCache::watch_(const std::string& relDir) {
+    std::string dir = srcDir_ + relDir;
+    int wd = inotify_add_watch(inotifyFd_, dir.data(), WATCH_MASK | IN_ONLYDIR);
+    if (wd < 0) {
+        LOG_WARN("FileCache: watch %s failed, errno:%d", dir.c_str(), errno);
+        return false;
+    }
+    wdDirs_[wd] = relDir;
+
+    DIR* dp = opendir(dir.data());
+    if (!dp) { return true; }
+    while (struct dirent* ent = readdir(dp)) {
+        if (!strcmp(ent->d_name, ".") || !strcmp(ent->d_name, "..")) { continue; }
+        std::string sub = relDir + "/" + ent->d_name;
+        struct stat st;
+        if (ent->d_type == DT_DIR || (ent->d_type == DT_UNKNOWN &&
+                stat((srcDir_ + sub).data(), &st) == 0 && S_ISDIR(st.st_mode))) {
+            watch_(sub);
+        }
+    }
+    closedir(dp);
+    return true;
+}
+
+void FileCache::watchLoop_() {
+    alignas(struct inotify_event) char buf[4096];
+    struct pollfd pfd = {inotifyFd_, POLLIN, 0};
+    while (!isClose_) {
+        // 带超时的 poll，以便 close() 时退出
+        if (poll(&pfd, 1, 200) <= 0) { continue; }
+        ssize_t len;
+        while ((len = read(inotifyFd_, buf, sizeof(buf))) > 0) {
+            for (char* p = buf; p < buf + len; ) {
+                auto* ev = reinterpret_cast<struct inotify_event*>(p);
+                p += sizeof(struct inotify_event) + ev->len;
+
+                if (ev->mask & IN_Q_OVERFLOW) {
+                    invalidateAll_();
+                    continue;
+                }
+                auto it = wdDirs_.find(ev->wd);
+                if (it == wdDirs_.end()) { continue; }
+                if (ev->mask & IN_IGNORED) {
+                    wdDirs_.erase(it);
+                    continue;
+                }
+                if (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+                    // 整个目录没了，目录下的条目不逐个追踪，直接清空
+                    invalidateAll_();
+                    continue;
+                }
+                if (ev->len == 0) { continue; }
+                std::string path = it->second + "/" + ev->name;
+                invalidate_(path);
+                if ((ev->mask & IN_ISDIR) && (ev->mask & (IN_CREATE | IN_MOVED_TO))) {
+                    watch_(path);
+                    invalidateAll_();   // 新目录下可能已有被负缓存的文件
+                }
+            }
+        }
+    }
+}
+
+void FileCache::invalidate_(const std::string& path) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    version_++;
+    auto it = cache_.find(path);
+    if (it != cache_.end()) { erase_(it); }
+}
+
+void FileCache::invalidateAll_() {
+    std::lock_guard<std::mutex> locker(mtx_);
+    version_++;
+    cache_.clear();
+    negatives_ = 0;
+}
+
+/* 调用方持有 mtx_ */
+void FileCache::erase_(std::unordered_map<std::string, EntryPtr>::iterator it) {
+    negatives_ -= it->second->err ? 1 : 0;
+    cache_.erase(it);
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <future>
+#include <optional>
+#include <thread>
+#include <atomic>
+#include <unordered_map>
+#include <sys/stat.h>
+
+#include "../log/log.h"
+
+/*
+静态文件缓存：按请求路径(相对 srcDir，如 "/index.html")缓存 stat 结果、打开的 fd 和整文件的只读 mmap，
+热点文件的请求不再走 stat/open/mmap/munmap。
+
+- 条目通过 shared_ptr 引用计数，正在发送的响应持有引用；条目失效或被淘汰后，
+  等最后一个引用释放时才 munmap/close。
+- 同一路径的并发未命中只由第一个线程加载，其余线程等待同一个 shared_future。
+- 后台线程用 inotify 监听 srcDir 整棵目录树，文件变化时删除对应条目(包括"不存在"的负缓存)。
+*/
+class FileCache {
+public:
+    struct Entry {
+        int err = 0;            // stat/open/mmap 失败时的 errno，0 表示成功
+        struct stat st = {};
+        int fd = -1;            // 只对可读的普通文件打开
+        char* addr = nullptr;   // 整个文件的只读映射；空文件/目录/失败，或大小不在 [mapMin, mapLimit) 内时为空
+        std::string etag;           // 由 mtime 与大小生成的强校验值，如 "\"65f1a2b3-c4f\""，只对打开的文件生成
+        std::string lastModified;   // mtime 的 HTTP 日期，如 "Sat, 17 Oct 2026 13:17:05 GMT"
+
+        ~Entry();
+    };
+    typedef std::shared_ptr<const Entry> EntryPtr;
+
+    static FileCache* Instance();
+
+    /*
+    只映射大小在 [mapMin, mapLimit) 内的文件，其余只保留 fd：
+    小于 mapMin 的由 ContentCache 读入内存，不小于 mapLimit 的由调用方用 sendfile 发送
+    */
+    void init(const std::string& srcDir, size_t mapMin = 0, size_t mapLimit = SIZE_MAX);
+    void close();
+
+    /*
+    总是返回非空条目，文件不存在等错误记录在 err 中。
+    derived：由已存在的文件派生的路径(如 .gz 兄弟文件)，数量受真实文件数限制，出错的结果不受 MAX_NEGATIVE 限制
+    */
+    EntryPtr get(const std::string& path, bool derived = false);
+
+    uint64_t hits() const { return hits_; }
+    uint64_t misses() const { return misses_; }
+    uint64_t loads() const { return loads_; }   // 真正访问文件系统的次数，并发未命中只算一次
+
+    static const size_t MAX_ENTRIES = 4096;
+    // 负缓存条目上限，超过后出错的结果不再缓存；取 MAX_ENTRIES 的 1/4，
+    // 随机 URL 扫描最多占掉四分之一，favicon.ico 等反复 404 的少量路径仍能命中
+    static const size_t MAX_NEGATIVE = MAX_ENTRIES / 4;
+
+private:
+    FileCache();
+    ~FileCache();
+
+    EntryPtr load_(const std::string& path) const;
+
+    bool watch_(const std::string& relDir);
+    void watchLoop_();
+    void invalidate_(const std::string& path);
+    void invalidateAll_();
+    void erase_(std::unordered_map<std::string, EntryPtr>::iterator it);
+
+    std::string srcDir_;
+    size_t mapMin_;
+    size_t mapLimit_;
+
+    std::mutex mtx_;
+    std::unordered_map<std::string, EntryPtr> cache_;
+    std::unordered_map<std::string, std::shared_future<EntryPtr>> loading_;    // 正在加载的路径
+    uint64_t version_;  // 每次失效递增，加载期间发生过失效的结果不入缓存
+    size_t negatives_;  // cache_ 中"不存在"等出错条目的数量
+
+    int inotifyFd_;
+    std::unordered_map<int, std::string> wdDirs_;   // inotify watch -> 相对目录，仅 init 与监听线程访问
+    std::atomic<bool> isClose_;
+    std::thread watcher_;
+
+    std::atomic<uint64_t> hits_;
+    std::atomic<uint64_t> misses_;
+    std::atomic<uint64_t> loads_;
+};
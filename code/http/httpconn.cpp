@@ -8,6 +8,10 @@ HttpConn::HttpConn() {
     fd_ = -1;
     addr_ = {0};
     isClose_ = true;
+    keepAlive_ = false;
+    syscalls_ = nullptr;
+    msg_ = {};
+    toWrite_ = 0;
 }
 
 HttpConn::~HttpConn() {
@@ -21,17 +25,27 @@ void HttpConn::initConn(int sockFd, const sockaddr_in& addr) {
     fd_ = sockFd;
     writeBuffer_.RetrieveAll();
     readBuffer_.RetrieveAll();
+    request_.init();
+    clearPending_();    // 复用的 HttpConn 可能残留上一个连接未写完的响应
+    keepAlive_ = false;
     isClose_ = false;
     LOG_INFO("Client[%d](%s:%d) in, userCount:%d", fd_,
             getIP(), getPort(), (int)userCount);
 }
 
-void HttpConn::closeConn() {
-    response_.unmapFile();
+void HttpConn::closeConn(bool closeFd) {
+    response_.closeFile();
+    clearPending_();
+    // 槽位要等 fd 复用才会重新 initConn，关闭时就把内存还回去
+    readBuffer_.RetrieveAll();
+    writeBuffer_.Shrink(WRITE_BUFFER_HIGH_WATER, 1024);
     if (isClose_ == false) {
         isClose_ = true; 
         userCount--;
-        close(fd_);
+        if (closeFd) {
+            close(fd_);
+            countSyscall_();
+        }
         LOG_INFO("Client[%d](%s:%d) quit, UserCount:%d", fd_, getIP(), getPort(), (int)userCount);
     }
 }
@@ -41,7 +55,8 @@ ssize_t HttpConn::read(int* saveError) {
     do {
         // 从 fd 读取数据到 buffer
         len = readBuffer_.ReadFd(fd_, saveError);
-        if (len < 0) break;
+        countSyscall_();
+        if (len <= 0) break;    // 出错/EAGAIN 或对端关闭(0)，ET 下不能再继续读
     } while(isET);
 
     return len;
@@ -49,58 +64,175 @@ ssize_t HttpConn::read(int* saveError) {
 
 ssize_t HttpConn::write(int* saveError) {
     ssize_t len = -1;
+    size_t quota = WRITE_QUANTUM;   // 本轮剩余的写配额
     do {
-        len = writev(fd_, iov_, iovCnt_);
+        bool more = false;
+        int cnt = fillIov_(&more, quota);
+        if (cnt > 0) {
+            // 后面紧跟 sendfile 的文件体时带 MSG_MORE，让响应头与文件开头合并成一个报文
+            struct msghdr msg = {};
+            msg.msg_iov = iov_.data();
+            msg.msg_iovlen = cnt;
+            len = sendmsg(fd_, &msg, more ? MSG_MORE : 0);
+        }
+        else {
+            // 队首是 sendfile 的文件体；offset 取自队首段，EAGAIN 后从断点继续
+            const Segment& s = pending_.front();
+            off_t off = s.off;
+            len = sendfile(fd_, s.fd, &off, std::min(s.len, quota));
+        }
+        countSyscall_();
         if(len <= 0) {
             *saveError = errno;
             break;
         }
-        if (iov_[0].iov_len + iov_[1].iov_len == 0) { break; }    // 传输结束
-        else if (static_cast<size_t>(len) > iov_[0].iov_len) {
-            // iov[0] 全部写，iov[1] 部分写
-            iov_[1].iov_base = (uint8_t*) iov_[1].iov_base + (len - iov_[0].iov_len);
-            iov_[1].iov_len -= (len - iov_[0].iov_len);
-            if (iov_[0].iov_len) {
-                writeBuffer_.RetrieveAll(); // what
-                iov_[0].iov_len = 0;
-            }
-        }
-        else {
-            // iov[0] 部分写
-            iov_[0].iov_base = (uint8_t*)iov_[0].iov_base + len;
-            iov_[0].iov_len -= len;
-            writeBuffer_.Retrieve(len); // what
-        }
-    } while( isET || toWriteBytes() > 10240);   // 当采用LT模式，只有当待发送数据 > 10KB 才循环 what
+        consume_(len);
+        quota -= len;
+    } while (toWrite_ > 0 && quota > 0);    // 写完、EAGAIN 或配额用完为止，ET/LT 相同
+    if (toWrite_ == 0) {
+        writeBuffer_.Shrink(WRITE_BUFFER_HIGH_WATER, 1024);
+    }
     return len;
 }
 
-bool HttpConn::process() {
-    request_.init();
-    if (readBuffer_.ReadableBytes() <= 0) {
-        return false;
+const struct msghdr* HttpConn::prepSend(bool* more, int* fileFd, off_t* off, size_t* len) {
+    assert(toWrite_ > 0);
+    *more = false;
+    int cnt = fillIov_(more, WRITE_QUANTUM);
+    if (cnt == 0) {
+        const Segment& s = pending_.front();
+        *fileFd = s.fd;
+        *off = s.off;
+        *len = s.len;
+        return nullptr;
     }
-    else if (request_.parse(readBuffer_)) {
-        LOG_DEBUG("%s", request_.path().c_str());
-        response_.init(srcDir, request_.path(),
-                request_.IsKeepAlive(), 200);
+    msg_ = {};
+    msg_.msg_iov = iov_.data();
+    msg_.msg_iovlen = cnt;
+    return &msg_;
+}
+
+void HttpConn::onSent(size_t len) {
+    consume_(len);
+    if (toWrite_ == 0) {
+        writeBuffer_.Shrink(WRITE_BUFFER_HIGH_WATER, 1024);
     }
-    else {
-        response_.init(srcDir, request_.path(), false, 400);        
+}
+
+/*
+按队列顺序把未写完的部分填入 iov_，最多 IOV_MAX 个、共 limit 字节；
+遇到需要 sendfile 的文件体时停下并置 *more，返回 0 表示队首就是 sendfile 的文件体
+*/
+int HttpConn::fillIov_(bool* more, size_t limit) {
+    iov_.clear();
+    const char* head = writeBuffer_.ReadPtr();
+    for (const Segment& s : pending_) {
+        if (limit == 0) { break; }
+        if (s.type == Segment::SENDFILE) {
+            *more = !iov_.empty();
+            break;
+        }
+        size_t len = std::min(s.len, limit);
+        const char* data = s.data;
+        if (s.type == Segment::BUFFER) {
+            data = head;
+            head += s.len;
+            // 相邻的 BUFFER 段在缓冲区里是连续的，合并成一个 iovec
+            if (!iov_.empty() && static_cast<char*>(iov_.back().iov_base) + iov_.back().iov_len == data) {
+                iov_.back().iov_len += len;
+                limit -= len;
+                continue;
+            }
+        }
+        if (iov_.size() >= IOV_MAX) { break; }
+        iov_.push_back({const_cast<char*>(data), len});
+        limit -= len;
+    }
+    return static_cast<int>(iov_.size());
+}
+
+/* 写出 len 字节后推进队列，写完的段释放对缓存的引用 */
+void HttpConn::consume_(size_t len) {
+    assert(len <= toWrite_);
+    toWrite_ -= len;
+    while (len > 0) {
+        Segment& s = pending_.front();
+        size_t n = std::min(len, s.len);
+        if (s.type == Segment::BUFFER) {
+            writeBuffer_.Retrieve(n);
+        }
+        else if (s.type == Segment::MEMORY) {
+            s.data += n;
+        }
+        else {
+            s.off += n;
+        }
+        s.len -= n;
+        len -= n;
+        if (s.len == 0) {
+            pending_.pop_front();
+        }
     }
+}
 
-    response_.makeResponse(writeBuffer_);
-    // 响应头
-    iov_[0].iov_base = const_cast<char*>(writeBuffer_.ReadPtr());
-    iov_[0].iov_len = writeBuffer_.ReadableBytes();
-    iovCnt_ = 1;
-    
-    // 文件
-    if (response_.fileLen() > 0 && response_.file()) {
-        iov_[1].iov_base = response_.file();
-        iov_[1].iov_len = response_.fileLen();
-        iovCnt_ = 2;
+void HttpConn::pushSegment_(Segment::TYPE type, size_t len, const char* data,
+        int fd, off_t off, const std::shared_ptr<const void>& holder) {
+    if (len == 0) { return; }
+    pending_.push_back({type, len, data, fd, off, holder});
+    toWrite_ += len;
+}
+
+void HttpConn::clearPending_() {
+    pending_.clear();
+    writeBuffer_.RetrieveAll();
+    toWrite_ = 0;
+}
+
+int HttpConn::process() {
+    int cnt = 0;
+    while (cnt < MAX_PIPELINE) {
+        HttpRequest::HTTP_CODE ret = request_.parse(readBuffer_);
+        if (ret == HttpRequest::NO_REQUEST) {
+            break;  // 剩余数据还不是完整请求，等待更多数据
+        }
+        else if (ret == HttpRequest::GET_REQUEST) {
+            LOG_DEBUG("%s", request_.path().c_str());
+            response_.init(srcDir, request_.path(),
+                    request_.IsKeepAlive(), 200);
+            response_.setConditions(request_.ifNoneMatch(), request_.ifModifiedSince());
+            response_.setRange(request_.range(), request_.ifRange());
+            response_.setAcceptGzip(request_.acceptGzip());
+        }
+        else {
+            request_.path() = "/400.html";  // 空路径会被 stat 成目录而返回 404
+            response_.init(srcDir, request_.path(), false, 400);
+        }
+
+        response_.makeResponse(writeBuffer_);
+        std::shared_ptr<const void> holder = response_.holder();
+        std::string_view head = response_.head();
+        std::string_view body = response_.body();
+        int fd = response_.bodyFd();
+        pushSegment_(Segment::MEMORY, head.size(), head.data(), -1, 0, holder);
+        for (const HttpResponse::Part& part : response_.parts()) {
+            pushSegment_(Segment::BUFFER, part.headLen);
+            if (fd >= 0) {
+                pushSegment_(Segment::SENDFILE, part.len, nullptr, fd, part.off, holder);
+            }
+            else {
+                pushSegment_(Segment::MEMORY, part.len, body.data() + part.off, -1, 0, holder);
+            }
+        }
+        pushSegment_(Segment::BUFFER, response_.tailLen());
+        LOG_DEBUG("filesize:%d, to %d", (int)response_.bodyLen(), (int)toWrite_);
+        response_.closeFile();
+        cnt++;
+
+        // 之后的请求不会再被响应，留在缓冲区里随连接关闭丢弃
+        keepAlive_ = ret == HttpRequest::GET_REQUEST && request_.IsKeepAlive();
+        if (!keepAlive_) {
+            break;
+        }
     }
-    LOG_DEBUG("filesize:%d, %d  to %d", response_.fileLen() , iovCnt_, toWriteBytes());
-    return true;
-}
\ No newline at end of file
+    return cnt;
+}
@@ -3,7 +3,12 @@
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/uio.h>     // readv/writev
+#include <sys/sendfile.h>
 #include <arpa/inet.h>
+#include <limits.h>      // IOV_MAX
+#include <deque>
+#include <vector>
+#include <memory>
 #include <stdlib.h>      // atoi()
 #include <errno.h> 
 #include <assert.h>
@@ -11,6 +16,7 @@
 #include "../log/log.h"
 #include "../pool/sqlconnRAII.h"
 #include "../buffer/buffer.h"
+#include "../buffer/chainbuffer.h"
 #include "httprequest.h"
 #include "httpresponse.h"
 
@@ -20,21 +26,50 @@ public:
     ~HttpConn();
 
     void initConn(int sockFd, const sockaddr_in& addr);
-    void closeConn();
+    // closeFd 为 false 时不 close(fd)，由调用方关闭(io_uring 完成模式以 IORING_OP_CLOSE 提交)
+    void closeConn(bool closeFd = true);
 
     ssize_t read(int* saveError);
+    /*
+    每次调用最多写出 WRITE_QUANTUM 字节，避免一个大文件下载长时间占住线程；
+    返回值 > 0 而 toWriteBytes() 仍非零表示本轮配额已用完，由调用方安排下一轮
+    */
     ssize_t write(int* saveError);
 
+    /*
+    io_uring 完成模式：读写由 EventLoop 以 SQE 提交，HttpConn 只管数据。
+    appendRead 交给读缓冲区一个已装有数据的 BlockPool 块，返回调用方应收回的块(见 ChainBuffer::AppendBlock)；
+    prepSend 给出下一次发送的内容(最多 WRITE_QUANTUM 字节)，返回的 msghdr 指向内部的 iov_，
+    在下一次 prepSend 之前有效，期间不能 process()；队首是 sendfile 的文件体时返回 nullptr，
+    由 fileFd、off、len 给出文件中待发送的范围，调用方读入后自行发送；
+    发送完成后以实际写出的字节数调用 onSent
+    */
+    char* appendRead(char* block, size_t len) { return readBuffer_.AppendBlock(block, len); }
+    const struct msghdr* prepSend(bool* more, int* fileFd, off_t* off, size_t* len);
+    void onSent(size_t len);
+
+    // 统计本连接上 read/write/close 等系统调用的计数器，由所属 EventLoop 设置
+    void setSyscallCounter(std::atomic<uint64_t>* counter) { syscalls_ = counter; }
+
     int getFd() const { return fd_; }
     const char* getIP() const { return inet_ntoa(addr_.sin_addr); }
     int getPort() const { return addr_.sin_port; }
     struct sockaddr_in getAddr() const { return addr_; }
 
-    bool process();
+    /*
+    解析读缓冲区中所有完整的请求(流水线)，按顺序排入待写队列，
+    返回排入的响应数，0 表示还没有完整请求；遇到非长连接或错误请求后不再继续解析。
+    */
+    int process();
+
+    size_t toWriteBytes() const { return toWrite_; }
 
-    int toWriteBytes() { return iov_[0].iov_len + iov_[1].iov_len; }
+    // 最后排入的响应是否保持连接；request_ 此时可能已开始解析下一个请求，不能直接用
+    bool isKeepAlive() const { return keepAlive_; }
 
-    bool isKeepAlive() const { return request_.IsKeepAlive(); }
+    static const size_t WRITE_QUANTUM = 256 * 1024;
+    // 写缓冲区排空后容量超过该值就缩回初始大小，长连接不会一直占着流水线高峰时的内存
+    static const size_t WRITE_BUFFER_HIGH_WATER = 16 * 1024;
 
     static bool isET;
     static const char* srcDir;
@@ -44,11 +79,44 @@ private:
     struct sockaddr_in addr_;   // 客户端地址信息
 
     bool isClose_;
+    bool keepAlive_;
+    std::atomic<uint64_t>* syscalls_;
+
+    /*
+    待写队列中的一段数据，一个响应由若干段按顺序组成：
+        BUFFER:   writeBuffer_ 中的响应头，各段在缓冲区里按顺序连续存放
+        MEMORY:   ContentCache 的预生成响应头/正文或 FileCache 的文件映射，随 BUFFER 一起 writev
+        SENDFILE: 没有映射的大文件，用 sendfile 发送
+    holder 持有缓存的引用直到这一段发送完成。
+    */
+    struct Segment {
+        enum TYPE { BUFFER, MEMORY, SENDFILE };
+        TYPE type;
+        size_t len;         // 剩余未写字节
+        const char* data;   // MEMORY 的当前位置
+        int fd;             // SENDFILE 的文件与当前偏移
+        off_t off;
+        std::shared_ptr<const void> holder;
+    };
+
+    void pushSegment_(Segment::TYPE type, size_t len, const char* data = nullptr,
+            int fd = -1, off_t off = 0, const std::shared_ptr<const void>& holder = nullptr);
+    int fillIov_(bool* more, size_t limit);
+    void consume_(size_t len);
+    void clearPending_();
+    void countSyscall_() {
+        if (syscalls_) { syscalls_->fetch_add(1, std::memory_order_relaxed); }
+    }
+
+    // 一次 process() 最多排入的响应数(普通响应至多 3 段)，保证 iovec 数不超过 IOV_MAX、缓存引用数有界
+    static const int MAX_PIPELINE = IOV_MAX / 3;
 
-    int iovCnt_;
-    struct iovec iov_[2];   // iov_[0]: 响应头, iov_[1]: 响应体(文件)
+    std::deque<Segment> pending_;
+    std::vector<struct iovec> iov_;
+    struct msghdr msg_;     // prepSend 交给 IORING_OP_SENDMSG
+    size_t toWrite_;
 
-    Buffer readBuffer_;
+    ChainBuffer readBuffer_;    // 块来自 BlockPool，请求解析完即归还
     Buffer writeBuffer_;
 
     HttpRequest request_;
@@ -0,0 +1,299 @@
+#include "httpparser.h"
+#include "httpscan.h"
+
+namespace {
+
+// RFC 7230 tchar: 方法名与头部名允许的字符
+struct TcharTable {
+    bool v[256] = {};
+    constexpr TcharTable() {
+        for (int c = '0'; c <= '9'; c++) { v[c] = true; }
+        for (int c = 'a'; c <= 'z'; c++) { v[c] = true; }
+        for (int c = 'A'; c <= 'Z'; c++) { v[c] = true; }
+        for (const char* p = "!#$%&'*+-.^_`|~"; *p; p++) {
+            v[static_cast<unsigned char>(*p)] = true;
+        }
+    }
+};
+constexpr TcharTable TCHAR;
+
+inline bool isTchar(unsigned char ch) { return TCHAR.v[ch]; }
+
+// 请求目标与头部值中允许的可见字符(含 obs-text)
+inline bool isVchar(unsigned char ch) { return ch > 0x20 && ch != 0x7f; }
+
+inline bool isOws(unsigned char ch) { return ch == ' ' || ch == '\t'; }
+
+inline char toLower(char ch) { return (ch >= 'A' && ch <= 'Z') ? ch - 'A' + 'a' : ch; }
+
+inline int hexValue(char ch) {
+    if (ch >= '0' && ch <= '9') return ch - '0';
+    if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+    if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+    return -1;
+}
+
+} // namespace
+
+void HttpParser::reset() {
+    base_ = nullptr;
+    state_ = METHOD;
+    pos_ = tok_ = valEnd_ = headLen_ = 0;
+    contentLength_ = 0;
+    hasContentLength_ = false;
+    method_ = path_ = version_ = body_ = key_ = {0, 0};
+    headerCnt_ = 0;
+}
+
+bool HttpParser::iequals(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) { return false; }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (toLower(a[i]) != toLower(b[i])) { return false; }
+    }
+    return true;
+}
+
+void HttpParser::normalizePath(std::string& path) {
+    size_t n = 0;
+    size_t i = 0;
+    while (i < path.size()) {
+        if (path[i] != '/') {
+            path[n++] = path[i++];
+            continue;
+        }
+        // 跳过紧随其后的 '/' 与 "." 段，只保留一个 '/'
+        i++;
+        while (i < path.size()) {
+            if (path[i] == '/') { i++; }
+            else if (path[i] == '.' && (i + 1 == path.size() || path[i + 1] == '/')) { i++; }
+            else { break; }
+        }
+        path[n++] = '/';
+    }
+    path.resize(n);
+}
+
+std::string_view HttpParser::header(std::string_view key) const {
+    for (size_t i = 0; i < headerCnt_; i++) {
+        if (iequals(view_(headers_[i].key), key)) {
+            return view_(headers_[i].value);
+        }
+    }
+    return std::string_view();
+}
+
+HttpParser::STATUS HttpParser::parse(const char* data, size_t len) {
+    base_ = data;
+    if (state_ == DONE) { return COMPLETE; }
+    if (state_ == FAILED) { return ERROR; }
+
+    while (pos_ < len) {
+        if (state_ == BODY) {
+            // body 只按 Content-Length 计数，不逐字节检查
+            size_t end = headLen_ + contentLength_;
+            pos_ = len < end ? len : end;
+            if (pos_ < end) { break; }
+            body_ = {static_cast<uint32_t>(headLen_), static_cast<uint32_t>(contentLength_)};
+            state_ = DONE;
+            return COMPLETE;
+        }
+
+        // token 中间用 SIMD 内核直接跳到下一个分隔符，剩下的交给状态机
+        if (state_ == PATH || state_ == HEADER_KEY || state_ == VALUE) {
+            pos_ = skip_(data, len);
+            if (pos_ == len) { break; }
+        }
+
+        unsigned char ch = data[pos_];
+        switch (state_) {
+            case METHOD: {
+                if (ch == ' ' && pos_ > 0) {
+                    method_ = {0, static_cast<uint32_t>(pos_)};
+                    tok_ = pos_ + 1;
+                    state_ = PATH;
+                }
+                else if (!isTchar(ch)) { state_ = FAILED; }
+            }break;
+
+            case PATH: {
+                if (ch == ' ' && pos_ > tok_) {
+                    path_ = {static_cast<uint32_t>(tok_), static_cast<uint32_t>(pos_ - tok_)};
+                    tok_ = pos_ + 1;
+                    state_ = VERSION;
+                }
+                else if (!isVchar(ch)) { state_ = FAILED; }
+            }break;
+
+            case VERSION: {
+                // 只接受 "HTTP/d.d\r"，按与 token 起点的距离逐位校验
+                static const char PREFIX[] = "HTTP/";
+                size_t idx = pos_ - tok_;
+                bool ok;
+                if (idx < 5) { ok = (ch == PREFIX[idx]); }
+                else if (idx == 5 || idx == 7) { ok = (ch >= '0' && ch <= '9'); }
+                else if (idx == 6) { ok = (ch == '.'); }
+                else {
+                    ok = (ch == '\r');
+                    version_ = {static_cast<uint32_t>(tok_ + 5), 3};
+                    state_ = LINE_LF;
+                }
+                if (!ok) { state_ = FAILED; }
+            }break;
+
+            case LINE_LF: {
+                state_ = (ch == '\n') ? HEADER_START : FAILED;
+            }break;
+
+            case HEADER_START: {
+                if (ch == '\r') { state_ = HEAD_LF; }
+                else if (isTchar(ch) && headerCnt_ < MAX_HEADERS) {
+                    tok_ = pos_;
+                    state_ = HEADER_KEY;
+                }
+                else { state_ = FAILED; }   // 包括已废弃的折行(以空白开头的续行)
+            }break;
+
+            case HEADER_KEY: {
+                if (ch == ':') {
+                    key_ = {static_cast<uint32_t>(tok_), static_cast<uint32_t>(pos_ - tok_)};
+                    state_ = VALUE_START;
+                }
+                else if (!isTchar(ch)) { state_ = FAILED; }
+            }break;
+
+            case VALUE_START: {
+                if (ch == '\r') {
+                    tok_ = valEnd_ = pos_;
+                    state_ = finishHeader_() ? LINE_LF : FAILED;
+                }
+                else if (isVchar(ch)) {
+                    tok_ = pos_;
+                    state_ = VALUE;
+                }
+                else if (!isOws(ch)) { state_ = FAILED; }
+            }break;
+
+            case VALUE: {
+                // skip_ 已停在控制字符上，去掉值尾部的空白
+                if (ch == '\r') {
+                    valEnd_ = pos_;
+                    while (isOws(data[valEnd_ - 1])) { valEnd_--; }
+                    state_ = finishHeader_() ? LINE_LF : FAILED;
+                }
+                else { state_ = FAILED; }
+            }break;
+
+            case HEAD_LF: {
+                if (ch == '\n') {
+                    headLen_ = pos_ + 1;
+                    state_ = contentLength_ > 0 ? BODY : DONE;
+                }
+                else { state_ = FAILED; }
+            }break;
+
+            default: break;
+        }
+        pos_++;
+        if (state_ == FAILED) { return ERROR; }
+        if (state_ == DONE) { return COMPLETE; }
+    }
+
+    if (state_ != BODY && pos_ > MAX_HEAD_SIZE) {
+        state_ = FAILED;
+        return ERROR;
+    }
+    return INCOMPLETE;
+}
+
+/* 从 pos_ 开始跳过当前 token 内的合法字符，返回需要状态机处理的位置 */
+size_t HttpParser::skip_(const char* data, size_t len) const {
+    const char* begin = data + pos_;
+    const char* end = data + len;
+    const char* p = end;
+    switch (state_) {
+        case PATH: p = HttpScan::findSpaceOrCtl(begin, end); break;
+        case VALUE: p = HttpScan::findCtl(begin, end); break;
+        case HEADER_KEY: {
+            // 先找 ':'，再校验其间都是 tchar；遇到非法字符就停在那里由状态机报错
+            p = HttpScan::findChars(begin, end, ":", 1);
+            for (const char* q = begin; q < p; q++) {
+                if (!isTchar(*q)) { return q - data; }
+            }
+        }break;
+        default: p = begin; break;
+    }
+    return p - data;
+}
+
+/* 保存一个头部，并处理影响报文边界的 Content-Length / Transfer-Encoding */
+bool HttpParser::finishHeader_() {
+    Header& h = headers_[headerCnt_++];
+    h.key = key_;
+    h.value = {static_cast<uint32_t>(tok_), static_cast<uint32_t>(valEnd_ - tok_)};
+
+    std::string_view key = view_(h.key);
+    if (iequals(key, "Content-Length")) {
+        std::string_view value = view_(h.value);
+        if (value.empty() || value.size() > 10) { return false; }
+        size_t n = 0;
+        for (char ch : value) {
+            if (ch < '0' || ch > '9') { return false; }
+            n = n * 10 + (ch - '0');
+        }
+        // 重复且不一致的 Content-Length 可能被用来做请求走私，直接拒绝
+        if (n > MAX_BODY_SIZE || (hasContentLength_ && n != contentLength_)) { return false; }
+        contentLength_ = n;
+        hasContentLength_ = true;
+    }
+    else if (iequals(key, "Transfer-Encoding")) {
+        return false;   // 不支持分块请求体
+    }
+    return true;
+}
+
+void HttpParser::parseUrlencoded(std::string_view body,
+        std::unordered_map<std::string, std::string>& out) {
+    static const char DELIMS[] = "&=%+";
+    std::string key, value;
+    std::string* cur = &key;
+    const char* p = body.data();
+    const char* end = p + body.size();
+
+    while (p < end) {
+        // 两个分隔符之间的普通字符整段拷贝
+        const char* q = HttpScan::findChars(p, end, DELIMS, sizeof(DELIMS) - 1);
+        cur->append(p, q);
+        if (q == end) { break; }
+        p = q + 1;
+        switch (*q) {
+            case '=': {
+                if (cur == &key) { cur = &value; }
+                else { cur->push_back('='); }
+            }break;
+
+            case '&': {
+                if (!key.empty()) { out[key] = value; }
+                key.clear();
+                value.clear();
+                cur = &key;
+            }break;
+
+            case '+': {
+                cur->push_back(' ');
+            }break;
+
+            case '%': {
+                int hi = end - p >= 2 ? hexValue(p[0]) : -1;
+                int lo = hi >= 0 ? hexValue(p[1]) : -1;
+                if (lo >= 0) {
+                    cur->push_back(static_cast<char>(hi * 16 + lo));
+                    p += 2;
+                }
+                else { cur->push_back('%'); }   // 非法转义原样保留
+            }break;
+
+            default: break;
+        }
+    }
+    if (!key.empty()) { out[key] = value; }
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/*
+手写的 HTTP/1.1 请求解析状态机，直接扫描调用方(Buffer)的内存，不做堆分配、不回溯。
+
+- 可续解析：数据不完整时返回 INCOMPLETE，并记住当前状态与已扫描的位置；
+  下次传入同一个请求(起始地址可以变化，只要内容是在尾部追加)时从断点继续。
+- method/path/version/头部/body 记录为相对请求起点的偏移，
+  通过 string_view 访问，视图指向最近一次 parse() 传入的内存，调用方修改缓冲区后失效。
+- 遇到非法字符、超长头部、不支持的 Transfer-Encoding 等立即返回 ERROR。
+*/
+class HttpParser {
+public:
+    enum STATUS {
+        INCOMPLETE = 0,
+        COMPLETE,
+        ERROR,
+    };
+
+    static const size_t MAX_HEADERS = 64;
+    static const size_t MAX_HEAD_SIZE = 64 * 1024;      // 请求行 + 头部
+    static const size_t MAX_BODY_SIZE = 8 * 1024 * 1024;
+
+    HttpParser() { reset(); }
+
+    void reset();
+
+    STATUS parse(const char* data, size_t len);
+
+    // 已得出结果(COMPLETE 或 ERROR)，需要 reset() 才能解析下一个请求
+    bool finished() const { return state_ == DONE || state_ == FAILED; }
+
+    // 完整请求(请求行 + 头部 + body)的字节数，仅在 COMPLETE 后有意义
+    size_t consumed() const { return pos_; }
+
+    std::string_view method() const { return view_(method_); }
+    std::string_view path() const { return view_(path_); }
+    std::string_view version() const { return view_(version_); }     // 如 "1.1"
+    std::string_view body() const { return view_(body_); }
+
+    // 头部名大小写不敏感，不存在时返回空视图
+    std::string_view header(std::string_view key) const;
+
+    size_t headerCount() const { return headerCnt_; }
+    std::string_view headerKey(size_t idx) const { return view_(headers_[idx].key); }
+    std::string_view headerValue(size_t idx) const { return view_(headers_[idx].value); }
+
+    size_t contentLength() const { return contentLength_; }
+
+    static bool iequals(std::string_view a, std::string_view b);
+
+    // 就地规范化以 '/' 开头的路径：连续的 '/' 合并为一个，去掉 "." 段；".." 不处理，由调用方拒绝
+    static void normalizePath(std::string& path);
+
+    // 解析 application/x-www-form-urlencoded：'+' 解码为空格，%XX 解码为对应字节
+    static void parseUrlencoded(std::string_view body,
+            std::unordered_map<std::string, std::string>& out);
+
+private:
+    enum STATE {
+        METHOD,
+        PATH,
+        VERSION,
+        LINE_LF,        // 请求行/头部行末尾的 '\n'
+        HEADER_START,
+        HEADER_KEY,
+        VALUE_START,    // ':' 之后的可选空白
+        VALUE,
+        HEAD_LF,        // 空行的 '\n'
+        BODY,
+        DONE,
+        FAILED,
+    };
+
+    struct Span {
+        uint32_t off;
+        uint32_t len;
+    };
+
+    struct Header {
+        Span key;
+        Span value;
+    };
+
+    std::string_view view_(Span s) const { return std::string_view(base_ + s.off, s.len); }
+
+    size_t skip_(const char* data, size_t len) const;
+    bool finishHeader_();
+
+    const char* base_;
+    STATE state_;
+    size_t pos_;        // 已扫描到的位置
+    size_t tok_;        // 当前 token 的起点
+    size_t valEnd_;     // 头部值去掉尾部空白后的结束位置
+    size_t headLen_;
+    size_t contentLength_;
+    bool hasContentLength_;
+
+    Span method_, path_, version_, body_;
+    Span key_;
+    Header headers_[MAX_HEADERS];
+    size_t headerCnt_;
+};
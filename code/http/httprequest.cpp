@@ -14,9 +14,14 @@ const std::unordered_map<std::string, int> HttpRequest::DEFAULT_HTML_TAG {
 
 
 void HttpRequest::init() {
-    method_ = path_ = version_ = body_ = "";
-    state_ = REQUEST_LINE;
-    header_.clear();
+    path_ = "";
+    isKeepAlive_ = false;
+    ifNoneMatch_.clear();
+    ifModifiedSince_.clear();
+    range_.clear();
+    ifRange_.clear();
+    acceptGzip_ = false;
+    parser_.reset();
     post_.clear();
 }
 
@@ -36,67 +41,92 @@ std::string HttpRequest::GetPost(const char* key) const {
 }
 
 bool HttpRequest::IsKeepAlive() const {
-    if(header_.count("Connection") == 1) {
-        return header_.find("Connection")->second == "keep-alive" && version_ == "1.1";
-    }
+    return isKeepAlive_;
 }
 
-bool HttpRequest::parse(Buffer& buffer) {
-    const char CRLF[] = "\r\n";
+HttpRequest::HTTP_CODE HttpRequest::parse(ChainBuffer& buffer) {
     if (buffer.ReadableBytes() <= 0) {
-        return false;
+        return NO_REQUEST;
+    }
+    if (parser_.finished()) {
+        init();
+    }
+    // 请求通常落在一个块内，Pullup 不拷贝；跨块时合并，解析器从上次的断点继续
+    std::string_view data = buffer.Pullup();
+    switch (parser_.parse(data.data(), data.size())) {
+        case HttpParser::INCOMPLETE: return NO_REQUEST;
+        case HttpParser::ERROR: {
+            LOG_ERROR("Bad request");
+            buffer.RetrieveAll();
+            return BAD_REQUEST;
+        }
+        default: break;
     }
-    while (buffer.ReadableBytes() && state_ != FINISH) {
-        // 搜索 '\r\n' 第一次在buffer的出现位置
-        const char* lineEnd = std::search(buffer.ReadPtr(),
-                    buffer.WritePtrConst(), CRLF, CRLF + 2);
-        
-        // 拿到一行的数据
-        std::string line(buffer.ReadPtr(), lineEnd);
-        // 根据当前的不同状态解析此行数据
-        switch(state_) {
-            case REQUEST_LINE: {
-                if (!parseRequestLine_(line)) {
-                    return false;
-                }
-                parsePath_();
-            }break;
-
-            case HEADERS: {
-                parseHeader_(line);
-                if (buffer.ReadableBytes() <= 2) {
-                    state_ = FINISH;
-                }
-            }break;
-
-            case BODY: {
-                parseBody_(line);
-            }break;
 
-            default: break;
-        }
-        if (lineEnd == buffer.WritePtr()) {break;}
-        buffer.RetrieveUntil(lineEnd + 2);
+    path_.assign(parser_.path());
+    if (!parsePath_()) {
+        LOG_ERROR("Bad path");
+        buffer.RetrieveAll();
+        return BAD_REQUEST;
     }
-    LOG_DEBUG("[%s], [%s], [%s]", method_.c_str(), path_.c_str(), version_.c_str());
-    return true;
+    // HTTP/1.1 默认长连接，HTTP/1.0 需显式声明 keep-alive
+    std::string_view conn = parser_.header("Connection");
+    if (parser_.version() == "1.1") {
+        isKeepAlive_ = !HttpParser::iequals(conn, "close");
+    }
+    else {
+        isKeepAlive_ = HttpParser::iequals(conn, "keep-alive");
+    }
+    if (parser_.method() == "GET") {
+        // assign 复用已有容量；视图在 Retrieve 之后失效，这里必须拷出
+        ifNoneMatch_.assign(parser_.header("If-None-Match"));
+        ifModifiedSince_.assign(parser_.header("If-Modified-Since"));
+        range_.assign(parser_.header("Range"));
+        ifRange_.assign(parser_.header("If-Range"));
+        acceptGzip_ = acceptsGzip_(parser_.header("Accept-Encoding"));
+    }
+    parsePost_();
+
+    std::string_view method = parser_.method(), version = parser_.version();
+    LOG_DEBUG("[%.*s], [%s], [%.*s]", (int)method.size(), method.data(),
+            path_.c_str(), (int)version.size(), version.data());
+    buffer.Retrieve(parser_.consumed());
+    return GET_REQUEST;
 }
 
-bool HttpRequest::parseRequestLine_(const std::string& line) {
-    std::regex patten("^([^ ]*) ([^ ]*) HTTP/([^ ]*)$");
-    std::smatch subMatch;
-    if (std::regex_match(line, subMatch, patten)) {
-        method_ = subMatch[1];
-        path_ = subMatch[2];
-        version_ = subMatch[3];
-        state_ = HEADERS;
-        return true;
+/* Accept-Encoding 中有 gzip(或 x-gzip) 且 q 不为 0 */
+bool HttpRequest::acceptsGzip_(std::string_view acceptEncoding) {
+    while (!acceptEncoding.empty()) {
+        size_t comma = acceptEncoding.find(',');
+        std::string_view item = acceptEncoding.substr(0, comma);
+        acceptEncoding = comma == std::string_view::npos ? std::string_view() : acceptEncoding.substr(comma + 1);
+        size_t semi = item.find(';');
+        std::string_view coding = item.substr(0, semi);
+        while (!coding.empty() && coding.front() == ' ') { coding.remove_prefix(1); }
+        while (!coding.empty() && coding.back() == ' ') { coding.remove_suffix(1); }
+        if (!HttpParser::iequals(coding, "gzip") && !HttpParser::iequals(coding, "x-gzip")) {
+            continue;
+        }
+        if (semi == std::string_view::npos) { return true; }
+        std::string_view q = item.substr(semi + 1);
+        while (!q.empty() && q.front() == ' ') { q.remove_prefix(1); }
+        if (q.substr(0, 2) != "q=" && q.substr(0, 2) != "Q=") { return true; }
+        // q=0 / q=0.0 / q=0.000 表示不接受
+        return q.substr(2).find_first_not_of("0.") != std::string_view::npos;
     }
-    LOG_ERROR("RequestLine Error");
     return false;
 }
 
-void HttpRequest::parsePath_() {
+/* 返回 false 表示路径试图跳出资源目录 */
+bool HttpRequest::parsePath_() {
+    if (path_[0] != '/') {
+        return false;
+    }
+    // FileCache 按路径缓存、inotify 按规范路径失效，"//a.html"、"/./a.html" 必须落到同一个键上
+    HttpParser::normalizePath(path_);
+    if (path_.find("/..") != std::string::npos) {
+        return false;
+    }
     if (path_ == "/") {
         path_ = "/index.html";
     }
@@ -108,29 +138,14 @@ void HttpRequest::parsePath_() {
             }
         }
     }
-}
-
-void HttpRequest::parseHeader_(const std::string& line) {
-    std::regex patten("^([^:]*): ?(.*)$");
-    std::smatch subMatch;
-    if (std::regex_match(line, subMatch, patten)) {
-        header_[subMatch[1]] = subMatch[2];
-    }
-    else {
-        state_ = BODY;
-    }
-}
-
-void HttpRequest::parseBody_(const std::string& line) {
-    body_ = line;
-    parsePost_();
-    state_ = FINISH;
-    LOG_DEBUG("Body:%s, len:%d", line.c_str(), line.size());
+    return true;
 }
 
 void HttpRequest::parsePost_() {
-    if(method_ == "POST" && header_["Content-Type"] == 
+    if(parser_.method() == "POST" && parser_.header("Content-Type") ==
                 "application/x-www-form-urlencoded") {
+        std::string_view body = parser_.body();
+        LOG_DEBUG("Body:%.*s, len:%d", (int)body.size(), body.data(), (int)body.size());
         parseFromUrlencoded_();
         if(DEFAULT_HTML_TAG.count(path_)) {
             int tag = DEFAULT_HTML_TAG.find(path_)->second;
@@ -150,50 +165,7 @@ void HttpRequest::parsePost_() {
 }
 
 void HttpRequest::parseFromUrlencoded_() {
-    if(body_.size() == 0) { return; }
-    
-    std::string key, value;
-    int num = 0;
-    int n = body_.size();
-    int i = 0, j = 0;
-
-    for (; i < n; i ++) {
-        char ch = body_[i];
-        switch (ch) {
-            case '=': {
-                key = body_.substr(j, i - j);
-                j = i + 1;
-            }break;
-
-            case '+': {
-                /* '+' 解释为空格 */
-                body_[i] = ' ';
-            }break;
-
-            case '%': {
-                num = converHex(body_[i + 1] * 16 + converHex(body_[i + 2] * 16));
-                body_[i + 2] = num % 10 + '0';
-                body_[i + 1] = num / 10 + '0';
-                i += 2;
-            }break;
-
-            case '&': {
-                value = body_.substr(j, i - j);
-                j = i + 1;
-                post_[key] = value;
-                LOG_DEBUG("%s = %s", key.c_str(), value.c_str());
-            }break;
-
-            default: break;
-        }   
-    }
-    assert(j <= i);
-    
-    // 尾部处理
-    if(post_.count(key) == 0 && j < i) {
-        value = body_.substr(j, i - j);
-        post_[key] = value;
-    }
+    HttpParser::parseUrlencoded(parser_.body(), post_);
 }
 
 bool HttpRequest::userVerify(const std::string& name, 
@@ -257,10 +229,3 @@ bool HttpRequest::userVerify(const std::string& name,
     LOG_DEBUG( "Read MYSQL: UserVerify success!");
     return flag;
 }
-
-/*16进制 -> 10进制*/
-int HttpRequest::converHex(char ch) {
-    if(ch >= 'A' && ch <= 'F') return ch -'A' + 10;
-    if(ch >= 'a' && ch <= 'f') return ch -'a' + 10;
-    return ch;
-}
\ No newline at end of file
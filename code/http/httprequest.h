@@ -3,12 +3,13 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <string>
+#include <string_view>
 #include <errno.h>
 #include <algorithm>
-#include <regex>
 
 
-#include "../buffer/buffer.h"
+#include "httpparser.h"
+#include "../buffer/chainbuffer.h"
 #include "../log/log.h"
 #include "../pool/sqlconnpool.h"
 #include "../pool/sqlconnRAII.h"
@@ -16,13 +17,6 @@
 
 class HttpRequest {
 public:
-    enum PARSE_STATE {
-        REQUEST_LINE,
-        HEADERS,
-        BODY,
-        FINISH
-    };
-
     enum HTTP_CODE {
         NO_REQUEST = 0,
         GET_REQUEST,
@@ -38,37 +32,51 @@ public:
     ~HttpRequest() = default;
 
     void init();
-    bool parse(Buffer& buffer);
+    /*
+    解析状态保存在 HttpRequest(即连接)上，请求不完整时下次调用只扫描新到的字节；
+    上一个请求已出结果时才 init() 开始解析下一个。
+    NO_REQUEST:  请求不完整，数据保留在 buffer 中等待后续读取
+    GET_REQUEST: 解析出一个完整请求，并从 buffer 中取走
+    BAD_REQUEST: 请求格式错误，buffer 被清空
+    */
+    HTTP_CODE parse(ChainBuffer& buffer);
 
-    // TODO
     std::string path() const {return path_;}
     std::string& path() {return path_;}
-    std::string method() const {return method_;}
-    std::string version() const {return version_;}
+    // 以下视图指向读缓冲区，只在 parse 返回 GET_REQUEST 之前(解析过程中)有效
+    std::string_view method() const {return parser_.method();}
+    std::string_view version() const {return parser_.version();}
     std::string GetPost(const std::string& key) const;
     std::string GetPost(const char* key) const;
 
     bool IsKeepAlive() const;
 
-private:
-    bool parseRequestLine_(const std::string& line);
-    void parseHeader_(const std::string& line);
-    void parseBody_(const std::string& line);
+    // 条件请求头(只对 GET 保存)，解析完成时从读缓冲区拷出，下一个请求开始解析前有效
+    const std::string& ifNoneMatch() const { return ifNoneMatch_; }
+    const std::string& ifModifiedSince() const { return ifModifiedSince_; }
+    const std::string& range() const { return range_; }
+    const std::string& ifRange() const { return ifRange_; }
+    bool acceptGzip() const { return acceptGzip_; }
 
-    void parsePath_();
+private:
+    bool parsePath_();
+    static bool acceptsGzip_(std::string_view acceptEncoding);
     void parsePost_();
     void parseFromUrlencoded_();
 
     static bool userVerify(const std::string& name, 
                         const std::string& pwd, bool isLogin);
 
-    PARSE_STATE state_;
-    std::string method_, path_, version_, body_;
-    std::unordered_map<std::string, std::string> header_;   // 请求头
+    HttpParser parser_;
+    std::string path_;
+    bool isKeepAlive_;
+    std::string ifNoneMatch_;
+    std::string ifModifiedSince_;
+    std::string range_;
+    std::string ifRange_;
+    bool acceptGzip_;
     std::unordered_map<std::string, std::string> post_;     // POST 数据
     
     static const std::unordered_set<std::string> DEFAULT_HTML;
     static const std::unordered_map<std::string, int> DEFAULT_HTML_TAG;
-
-    static int converHex(char ch);
 };
@@ -1,35 +1,72 @@
 #include "httpresponse.h"
-#include <sys/mman.h>
-
-const std::unordered_map<std::string, std::string> HttpResponse::SUFFIX_TYPE = {
-    { ".html",  "text/html" },
-    { ".xml",   "text/xml" },
-    { ".xhtml", "application/xhtml+xml" },
-    { ".txt",   "text/plain" },
-    { ".rtf",   "application/rtf" },
-    { ".pdf",   "application/pdf" },
-    { ".word",  "application/nsword" },
-    { ".png",   "image/png" },
-    { ".gif",   "image/gif" },
-    { ".jpg",   "image/jpeg" },
-    { ".jpeg",  "image/jpeg" },
-    { ".au",    "audio/basic" },
-    { ".mpeg",  "video/mpeg" },
-    { ".mpg",   "video/mpeg" },
-    { ".avi",   "video/x-msvideo" },
-    { ".gz",    "application/x-gzip" },
-    { ".tar",   "application/x-tar" },
-    { ".css",   "text/css "},
-    { ".js",    "text/javascript "},
+
+/*
+Cache-Control 策略：
+    页面每次都向服务器确认(no-cache，配合 ETag 多数请求只回 304)；
+    样式/脚本缓存一天；图片、字体、音视频等很少变化的资源缓存一周
+*/
+static const std::string_view CC_PAGE = "no-cache";
+static const std::string_view CC_ASSET = "max-age=86400";
+static const std::string_view CC_STATIC = "max-age=604800";
+
+const HttpResponse::FileType HttpResponse::DEFAULT_TYPE = { "text/plain", CC_PAGE, false };
+
+// 扩展名 -> { MIME 类型, Cache-Control, 是否 gzip 压缩(已压缩的图片/音视频/woff 不再压缩) }
+const std::unordered_map<std::string_view, HttpResponse::FileType> HttpResponse::SUFFIX_TYPE = {
+    { ".html",  { "text/html",                     CC_PAGE,   true } },
+    { ".xml",   { "text/xml",                      CC_PAGE,   true } },
+    { ".xhtml", { "application/xhtml+xml",         CC_PAGE,   true } },
+    { ".txt",   { "text/plain",                    CC_PAGE,   true } },
+    { ".rtf",   { "application/rtf",               CC_STATIC, true } },
+    { ".pdf",   { "application/pdf",               CC_STATIC, false } },
+    { ".word",  { "application/nsword",            CC_STATIC, false } },
+    { ".png",   { "image/png",                     CC_STATIC, false } },
+    { ".gif",   { "image/gif",                     CC_STATIC, false } },
+    { ".jpg",   { "image/jpeg",                    CC_STATIC, false } },
+    { ".jpeg",  { "image/jpeg",                    CC_STATIC, false } },
+    { ".ico",   { "image/x-icon",                  CC_STATIC, true } },
+    { ".svg",   { "image/svg+xml",                 CC_STATIC, true } },
+    { ".au",    { "audio/basic",                   CC_STATIC, false } },
+    { ".mpeg",  { "video/mpeg",                    CC_STATIC, false } },
+    { ".mpg",   { "video/mpeg",                    CC_STATIC, false } },
+    { ".mp4",   { "video/mp4",                     CC_STATIC, false } },
+    { ".avi",   { "video/x-msvideo",               CC_STATIC, false } },
+    { ".gz",    { "application/x-gzip",            CC_STATIC, false } },
+    { ".tar",   { "application/x-tar",             CC_STATIC, false } },
+    { ".css",   { "text/css",                      CC_ASSET,  true } },
+    { ".js",    { "text/javascript",               CC_ASSET,  true } },
+    { ".woff",  { "font/woff",                     CC_STATIC, false } },
+    { ".woff2", { "font/woff2",                    CC_STATIC, false } },
+    { ".ttf",   { "font/ttf",                      CC_STATIC, true } },
+    { ".otf",   { "font/otf",                      CC_STATIC, true } },
+    { ".eot",   { "application/vnd.ms-fontobject", CC_STATIC, true } },
 };
 
-const std::unordered_map<int, std::string> HttpResponse::CODE_STATUS = {
+const std::unordered_map<int, std::string_view> HttpResponse::CODE_STATUS = {
     { 200, "OK" },
+    { 206, "Partial Content" },
+    { 304, "Not Modified" },
     { 400, "Bad Request" },
     { 403, "Forbidden" },
     { 404, "Not Found" },
+    { 416, "Range Not Satisfiable" },
 };
 
+// 预先拼好的状态行，与 CODE_STATUS 一一对应
+const std::unordered_map<int, std::string_view> HttpResponse::STATUS_LINE = {
+    { 200, "HTTP/1.1 200 OK\r\n" },
+    { 206, "HTTP/1.1 206 Partial Content\r\n" },
+    { 304, "HTTP/1.1 304 Not Modified\r\n" },
+    { 400, "HTTP/1.1 400 Bad Request\r\n" },
+    { 403, "HTTP/1.1 403 Forbidden\r\n" },
+    { 404, "HTTP/1.1 404 Not Found\r\n" },
+    { 416, "HTTP/1.1 416 Range Not Satisfiable\r\n" },
+};
+
+static const std::string_view BOUNDARY = "WebServerFromZeroByteRanges";
+
+std::unordered_map<int, ContentCache::BlobPtr> HttpResponse::ERROR_PAGES;
+
 const std::unordered_map<int, std::string> HttpResponse::CODE_PATH = {
     { 400, "/400.html" },
     { 403, "/403.html" },
@@ -37,128 +74,587 @@ const std::unordered_map<int, std::string> HttpResponse::CODE_PATH = {
 };
 
 HttpResponse::HttpResponse(): code_(-1), isKeepAlive_(false), path_(""), 
-                            srcDir_(""), mmFile_(nullptr),
-                            mmFileStat_({0}) {}
+                            srcDir_(""), acceptGzip_(false), gzip_(false), tailLen_(0) {}
 
 HttpResponse::~HttpResponse() {
-    unmapFile();
+    closeFile();
 }
 
-void HttpResponse::init(const std::string& srcDir, std::string& path, 
+void HttpResponse::init(std::string_view srcDir, std::string& path, 
         bool isKeepAlive, int code) {
     assert(srcDir != "");
-    if(mmFile_) { unmapFile(); }
+    closeFile();
     code_ = code;
     isKeepAlive_ = isKeepAlive;
     path_ = path;
-    srcDir_ = srcDir;
-    mmFile_ = nullptr; 
-    mmFileStat_ = { 0 };
+    srcDir_.assign(srcDir);     // 复用已有容量，不重新分配
+    ifNoneMatch_ = std::string_view();
+    ifModifiedSince_ = std::string_view();
+    range_ = std::string_view();
+    ifRange_ = std::string_view();
+    acceptGzip_ = false;
+    gzip_ = false;
+}
+
+void HttpResponse::setConditions(std::string_view ifNoneMatch, std::string_view ifModifiedSince) {
+    ifNoneMatch_ = ifNoneMatch;
+    ifModifiedSince_ = ifModifiedSince;
+}
+
+void HttpResponse::setRange(std::string_view range, std::string_view ifRange) {
+    range_ = range;
+    ifRange_ = ifRange;
+}
+
+void HttpResponse::setAcceptGzip(bool acceptGzip) {
+    acceptGzip_ = acceptGzip;
 }
 
 void HttpResponse::makeResponse(Buffer& buffer) {
+    size_t start = buffer.ReadableBytes();
+    parts_.clear();
+    tailLen_ = 0;
+    if (code_ >= 400 && errorPage_(buffer, start)) {
+        return;     // 解析出错的请求不必查找文件
+    }
+    file_ = FileCache::Instance()->get(path_);
     /* 路径不存在或是目录 */
-    if (stat((srcDir_ + path_).data(), &mmFileStat_) < 0 ||
-        S_ISDIR(mmFileStat_.st_mode)) {
+    if (file_->err || S_ISDIR(file_->st.st_mode)) {
         code_ = 404;
     }
     /* 无读权限 */
-    else if (!(mmFileStat_.st_mode & S_IROTH)) {
+    else if (!(file_->st.st_mode & S_IROTH)) {
         code_ = 403;
     }
     else if (code_ == -1) {
         code_ = 200;
     }
+    if (code_ >= 400 && errorPage_(buffer, start)) {
+        return;
+    }
     errorHtml_();
-    addStateLine_(buffer);
-    addHeader_(buffer);
-    addContent_(buffer);
+    if (code_ == 200 && notModified_()) {
+        // 304 没有响应体，只带校验值与缓存策略
+        code_ = 304;
+        addStateLine_(buffer);
+        addHeader_(buffer);
+        addValidators_(buffer);
+        buffer.Append("\r\n");
+        file_.reset();
+        parts_.push_back({buffer.ReadableBytes() - start, 0, 0});
+        return;
+    }
+    // Range 只对未压缩的内容生效，带 Range 的请求不协商压缩
+    if (code_ == 200 && acceptGzip_ && range_.empty() && getFileType_().compress && loadGzip_()) {
+        if (!blob_) {
+            buffer.Append(blobHead_(bodyLen()));    // 大的 .gz 兄弟文件，响应头现场生成
+        }
+        addHeader_(buffer);
+        buffer.Append("\r\n");
+        parts_.push_back({buffer.ReadableBytes() - start, 0, bodyLen()});
+        return;
+    }
+    bool cached = loadBlob_();
+    if (code_ == 200 && !range_.empty() && makeRange_(buffer, start)) {
+        return;
+    }
+    if (cached) {
+        // 状态行、Content-type、Content-length 已预生成在 blob_ 中
+        addHeader_(buffer);
+        buffer.Append("\r\n");
+    }
+    else {
+        addStateLine_(buffer);
+        addHeader_(buffer);
+        addContentType_(buffer);
+        addValidators_(buffer);
+        addContent_(buffer);
+    }
+    parts_.push_back({buffer.ReadableBytes() - start, 0, bodyLen()});
+}
+
+std::string_view HttpResponse::head() const {
+    // 206/416 等由 Blob 正文生成的响应不用 Blob 里 200 的响应头
+    return (blob_ && blob_->code == code_) ? std::string_view(blob_->head) : std::string_view();
 }
 
-void HttpResponse::unmapFile() {
-    if (mmFile_) {
-        munmap(mmFile_, mmFileStat_.st_size);
-        mmFile_ = nullptr;
+std::string_view HttpResponse::body() const {
+    if (blob_) { return blob_->body; }
+    if (hasBody_() && bodyFile_()->addr) {
+        return std::string_view(bodyFile_()->addr, bodyFile_()->st.st_size);
     }
+    return std::string_view();
 }
 
-void HttpResponse::errorContent(Buffer& buffer, std::string message) {
+int HttpResponse::bodyFd() const {
+    return (!blob_ && hasBody_() && !bodyFile_()->addr) ? bodyFile_()->fd : -1;
+}
+
+size_t HttpResponse::bodyLen() const {
+    if (blob_) { return blob_->body.size(); }
+    return hasBody_() ? bodyFile_()->st.st_size : 0;
+}
+
+std::shared_ptr<const void> HttpResponse::holder() const {
+    if (blob_) { return blob_; }
+    return bodyFile_();
+}
+
+/* 小文件从 ContentCache 取预生成的响应头与正文，未命中时读文件生成并放入缓存 */
+bool HttpResponse::loadBlob_() {
+    ContentCache* cache = ContentCache::Instance();
+    if (!cache->enabled() || file_->err || file_->fd < 0 ||
+            !ContentCache::cacheable(file_->st.st_size)) {
+        return false;
+    }
+    blob_ = cache->get(path_, file_, code_);
+    if (blob_) { return true; }
+
+    ContentCache::Blob blob;
+    if (!ContentCache::readFile(*file_, blob.body)) {
+        return false;   // 退回普通路径，正文用 sendfile 发送
+    }
+    blob.source = file_;
+    blob.code = code_;
+    blob.head = blobHead_(blob.body.size());
+    blob_ = cache->put(path_, std::move(blob));
+    return true;
+}
+
+/*
+gzip 变体，与原文件一起缓存在 ContentCache 中(key 为 path_ + ".gz")：
+优先使用不旧于原文件的 .gz 兄弟文件，小于 MAX_OBJECT 的读入缓存，更大的与普通文件一样映射或 sendfile 发送；
+没有时提交后台压缩，压缩完成前先发送未压缩的内容，请求路径上不做压缩。
+压缩结果不小于 MAX_OBJECT 时不缓存，与小文件的 Blob 共用同一份预算
+*/
+bool HttpResponse::loadGzip_() {
+    ContentCache* cache = ContentCache::Instance();
+    size_t size = file_->st.st_size;
+    if (!cache->enabled() || file_->err || file_->fd < 0 || size < GZIP_MIN) {
+        return false;
+    }
+    gzPath_.assign(path_);
+    gzPath_ += ".gz";
+    FileCache::EntryPtr sibling = FileCache::Instance()->get(gzPath_, true);
+    // 只有可用的兄弟文件参与比对：不存在的条目未必被缓存，每次取到的都是新对象，按指针比对永远不命中
+    if (sibling->err || sibling->fd < 0 || !S_ISREG(sibling->st.st_mode) ||
+            sibling->st.st_mtime < file_->st.st_mtime || sibling->st.st_size == 0) {
+        sibling.reset();
+    }
+    if (sibling && !ContentCache::cacheable(sibling->st.st_size)) {
+        gzFile_ = sibling;
+        gzip_ = true;
+        return true;
+    }
+    if (!sibling && size > GZIP_MAX) {
+        return false;   // 没有 .gz 文件，太大的不做后台压缩
+    }
+    blob_ = cache->get(gzPath_, file_, code_, sibling);
+    if (blob_) {
+        if (blob_->head.empty()) {
+            blob_.reset();  // 压缩后不比原文件小或仍太大，发送原文件
+            return false;
+        }
+        gzip_ = true;
+        return true;
+    }
+
+    ContentCache::Blob blob;
+    blob.source = file_;
+    blob.variant = sibling;
+    blob.code = code_;
+    if (sibling) {
+        if (!ContentCache::readFile(*sibling, blob.body)) { return false; }
+        gzip_ = true;
+        blob.head = blobHead_(blob.body.size());
+        blob_ = cache->put(gzPath_, std::move(blob));
+        return true;
+    }
+
+    std::string path = path_, key = gzPath_;
+    Compressor::Instance()->submit(key, [path, key, blob = std::move(blob)]() mutable {
+        std::string plain;
+        if (!ContentCache::readFile(*blob.source, plain) || !Compressor::gzip(plain, blob.body)) {
+            return;
+        }
+        if (blob.body.size() < plain.size() && ContentCache::cacheable(blob.body.size())) {
+            HttpResponse response;
+            response.path_ = path;
+            response.file_ = blob.source;
+            response.code_ = blob.code;
+            response.gzip_ = true;
+            blob.head = response.blobHead_(blob.body.size());
+        }
+        else {
+            blob.body.clear();  // 不值得压缩或压缩后仍太大，留一个空 Blob 避免反复提交
+        }
+        ContentCache::Instance()->put(key, std::move(blob));
+    });
+    return false;
+}
+
+/* Blob 中预生成的响应头：状态行、Content-type、Content-Encoding、校验值、Content-length */
+std::string HttpResponse::blobHead_(size_t bodyLen) {
+    Buffer head(512);
+    addStateLine_(head);
+    addContentType_(head);
+    if (gzip_) {
+        head.Append("Content-Encoding: gzip\r\n");
+    }
+    addValidators_(head);
+    head.Append("Content-length: ");
+    head.AppendDecimal(bodyLen);
+    head.Append("\r\n");
+    return head.RetrieveAllToStr();
+}
+
+std::string HttpResponse::errorBody_(int code, const std::string& message) {
     std::string body;
-    std::string status;
+    std::string_view status;
     body += "<html><title>Error</title>";
     body += "<body bgcolor=\"ffffff\">";
-    if(CODE_STATUS.count(code_) == 1) {
-        status = CODE_STATUS.find(code_)->second;
+    if(CODE_STATUS.count(code) == 1) {
+        status = CODE_STATUS.find(code)->second;
     } else {
         status = "Bad Request";
     }
-    body += std::to_string(code_) + " : " + status  + "\n";
+    body += std::to_string(code) + " : ";
+    body += status;
+    body += "\n";
     body += "<p>" + message + "</p>";
     body += "<hr><em>WebServer_from_zero</em></body></html>";
+    return body;
+}
 
-    buffer.Append("Content-length: " + std::to_string(body.size()) + "\r\n\r\n");
+void HttpResponse::errorContent(Buffer& buffer, std::string message) {
+    std::string body = errorBody_(code_, message);
+    buffer.Append("Content-length: ");
+    buffer.AppendDecimal(body.size());
+    buffer.Append("\r\n\r\n");
     buffer.Append(body);
 }
 
+/*
+启动时把 CODE_PATH 中的错误页面读入内存，生成带完整响应头的不可变 Blob；
+页面文件不存在时用 errorBody_ 生成。之后的错误响应不再访问文件系统，
+修改错误页面需要重启。必须在处理请求之前(单线程)调用。
+*/
+void HttpResponse::loadErrorPages() {
+    ERROR_PAGES.clear();
+    for (const auto& [code, path] : CODE_PATH) {
+        FileCache::EntryPtr file = FileCache::Instance()->get(path);
+        ContentCache::Blob blob;
+        blob.code = code;
+        bool found = !file->err && file->fd >= 0 && ContentCache::readFile(*file, blob.body);
+        if (!found) {
+            blob.body = errorBody_(code, "File Not Found!");
+        }
+        HttpResponse response;
+        response.path_ = path;
+        response.code_ = code;
+        blob.head = response.blobHead_(blob.body.size());
+        ERROR_PAGES[code] = std::make_shared<const ContentCache::Blob>(std::move(blob));
+        LOG_INFO("Error page %d: %s, %zu bytes", code, found ? path.c_str() : "(generated)",
+                ERROR_PAGES[code]->body.size());
+    }
+}
+
+/* 发送预加载的错误页面，没有预加载时返回 false，走文件缓存 */
+bool HttpResponse::errorPage_(Buffer& buffer, size_t start) {
+    auto it = ERROR_PAGES.find(code_);
+    if (it == ERROR_PAGES.end()) { return false; }
+    file_.reset();
+    blob_ = it->second;
+    addHeader_(buffer);
+    buffer.Append("\r\n");
+    parts_.push_back({buffer.ReadableBytes() - start, 0, bodyLen()});
+    return true;
+}
+
 void HttpResponse::errorHtml_() {
     if(CODE_PATH.count(code_) == 1) {
         path_ = CODE_PATH.find(code_)->second;
-        stat((srcDir_ + path_).data(), &mmFileStat_);
+        file_ = FileCache::Instance()->get(path_);
     }
 }
 
 void HttpResponse::addStateLine_(Buffer& buffer) {
-    std::string status;
-    if(CODE_STATUS.count(code_) == 1) {
-        status = CODE_STATUS.find(code_)->second;
-    }
-    else {
+    auto it = STATUS_LINE.find(code_);
+    if (it == STATUS_LINE.end()) {
         code_ = 400;
-        status = CODE_STATUS.find(code_)->second;
+        it = STATUS_LINE.find(code_);
     }
-    buffer.Append("HTTP/1.1 " + std::to_string(code_) + " " + status + "\r\n");
+    buffer.Append(it->second);
 }
 
+/* 每个请求都不同的响应头：Date 与 Connection */
 void HttpResponse::addHeader_(Buffer& buffer) {
-    buffer.Append("Connection: ");
+    buffer.Append(date_());
     if (isKeepAlive_) {
-        buffer.Append("keep-alive\r\n");
-        buffer.Append("keep-alive: max=6, timeout=120\r\n");
+        buffer.Append("Connection: keep-alive\r\n"
+                      "keep-alive: max=6, timeout=120\r\n");
+    }
+    else {
+        buffer.Append("Connection: close\r\n");
+    }
+}
+
+void HttpResponse::addContentType_(Buffer& buffer) {
+    buffer.Append("Content-type: ");
+    buffer.Append(getFileType_().type);
+    buffer.Append("\r\n");
+}
+
+/*
+200/206/304 带上文件的 ETag、Last-Modified 与按扩展名配置的 Cache-Control，错误页面不带；
+gzip 变体的 ETag 在原 ETag 后加 "-gzip"，可压缩的类型都带 Vary: Accept-Encoding
+*/
+void HttpResponse::addValidators_(Buffer& buffer) {
+    if ((code_ != 200 && code_ != 206 && code_ != 304) || file_->etag.empty()) { return; }
+    const FileType& type = getFileType_();
+    buffer.Append("ETag: ");
+    if (gzip_) {
+        buffer.Append(std::string_view(file_->etag).substr(0, file_->etag.size() - 1));
+        buffer.Append("-gzip\"");
     }
     else {
-        buffer.Append("close\r\n");
+        buffer.Append(file_->etag);
     }
-    buffer.Append("Content-type: " + getFileType_() + "\r\n");
+    buffer.Append("\r\nLast-Modified: ");
+    buffer.Append(file_->lastModified);
+    buffer.Append("\r\nCache-Control: ");
+    buffer.Append(type.cacheControl);
+    if (type.compress) {
+        buffer.Append("\r\nVary: Accept-Encoding");
+    }
+    buffer.Append("\r\n");
+}
+
+/*
+RFC 7232：有 If-None-Match 时只按 ETag 判断(弱比较，"*" 匹配任意)，忽略 If-Modified-Since；
+否则 If-Modified-Since 不早于文件的修改时间即未修改
+*/
+bool HttpResponse::notModified_() {
+    if (file_->etag.empty()) { return false; }
+    // 304 里的 ETag 与客户端缓存的表示一致：只有匹配上 gzip 变体的 ETag 才回 -gzip，其余都回原 ETag
+    gzip_ = false;
+    if (!ifNoneMatch_.empty()) {
+        std::string_view etag = file_->etag;
+        std::string_view list = ifNoneMatch_;
+        while (!list.empty()) {
+            size_t comma = list.find(',');
+            std::string_view tag = list.substr(0, comma);
+            list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+            while (!tag.empty() && (tag.front() == ' ' || tag.front() == '\t')) { tag.remove_prefix(1); }
+            while (!tag.empty() && (tag.back() == ' ' || tag.back() == '\t')) { tag.remove_suffix(1); }
+            if (tag.substr(0, 2) == "W/") { tag.remove_prefix(2); }
+            if (tag == "*" || tag == etag) {
+                return true;
+            }
+            // gzip 变体的 ETag："<原 ETag 去掉结尾引号>-gzip""
+            if (tag.size() == etag.size() + 5 && tag.substr(0, etag.size() - 1) == etag.substr(0, etag.size() - 1) &&
+                    tag.substr(etag.size() - 1) == "-gzip\"") {
+                gzip_ = true;
+                return true;
+            }
+        }
+        return false;
+    }
+    if (!ifModifiedSince_.empty()) {
+        // 浏览器通常原样回传 Last-Modified，先比较字符串，避免解析日期
+        if (ifModifiedSince_ == file_->lastModified) { return true; }
+        char date[64];
+        if (ifModifiedSince_.size() >= sizeof(date)) { return false; }
+        memcpy(date, ifModifiedSince_.data(), ifModifiedSince_.size());
+        date[ifModifiedSince_.size()] = '\0';
+        struct tm tm = {};
+        const char* end = strptime(date, "%a, %d %b %Y %H:%M:%S GMT", &tm);
+        if (end && *end == '\0' && file_->st.st_mtime <= timegm(&tm)) { return true; }
+    }
+    return false;
+}
+
+/*
+"Date: <RFC 7231 格式的时间>\r\n"，每个线程缓存一份，秒数变化时才重新格式化；
+time() 走 vDSO，不进内核
+*/
+std::string_view HttpResponse::date_() {
+    static thread_local time_t last = -1;
+    static thread_local char buf[64];
+    static thread_local size_t len = 0;
+    time_t now = time(nullptr);
+    if (now != last) {
+        struct tm tm;
+        gmtime_r(&now, &tm);
+        len = strftime(buf, sizeof(buf), "Date: %a, %d %b %Y %H:%M:%S GMT\r\n", &tm);
+        last = now;
+    }
+    return std::string_view(buf, len);
 }
 
 void HttpResponse::addContent_(Buffer& buffer) {
-    int srcFd = open((srcDir_ + path_).data(), O_RDONLY);
-    if (srcFd < 0) {
+    // 文件的 fd 与映射都由 FileCache 持有，这里只读取缓存的结果
+    if (file_->err || file_->fd < 0) {
         errorContent(buffer, "File Not Found!");
         return;
     }
-    LOG_DEBUG("file path %s", (srcDir_ + path_).data());
+    LOG_DEBUG("file path %s%s", srcDir_.c_str(), path_.c_str());
+    buffer.Append("Content-length: ");
+    buffer.AppendDecimal(file_->st.st_size);
+    buffer.Append("\r\n\r\n");
+}
+
+/*
+处理 Range 请求(RFC 7233)，返回 false 表示忽略 Range、按完整文件响应：
+If-Range 与当前文件不符、语法错误或区间过多时忽略；没有可满足的区间时回 416。
+单个区间回 206 + Content-Range；多个区间回 multipart/byteranges，
+每段的分段头写入 buffer，正文仍从缓存的内存或文件(sendfile 带偏移)发送，不拷贝
+*/
+bool HttpResponse::makeRange_(Buffer& buffer, size_t start) {
+    // If-Range 只接受强 ETag 或完全相同的 Last-Modified
+    if (!ifRange_.empty() && ifRange_ != file_->etag && ifRange_ != file_->lastModified) {
+        return false;
+    }
+    if (file_->fd < 0 || !parseRange_(file_->st.st_size)) {
+        parts_.clear();
+        return false;
+    }
+    size_t size = file_->st.st_size;
+    if (parts_.empty()) {
+        code_ = 416;
+        addStateLine_(buffer);
+        addHeader_(buffer);
+        buffer.Append("Content-Range: bytes */");
+        buffer.AppendDecimal(size);
+        buffer.Append("\r\nContent-length: 0\r\n\r\n");
+        parts_.push_back({buffer.ReadableBytes() - start, 0, 0});
+        return true;
+    }
 
-    void* mmRet = mmap(NULL, mmFileStat_.st_size, PROT_READ,
-                MAP_PRIVATE, srcFd, 0);
-    if (mmRet == MAP_FAILED) {
-        errorContent(buffer, "File Not Found!");
-        return;
+    code_ = 206;
+    addStateLine_(buffer);
+    addHeader_(buffer);
+    addValidators_(buffer);
+    if (parts_.size() == 1) {
+        Part& part = parts_.front();
+        addContentType_(buffer);
+        addContentRange_(buffer, part, size);
+        buffer.Append("Content-length: ");
+        buffer.AppendDecimal(part.len);
+        buffer.Append("\r\n\r\n");
+        part.headLen = buffer.ReadableBytes() - start;
+        return true;
+    }
+
+    // 先生成所有分段头以算出总长度，再依次写入 buffer
+    Buffer heads(256 * parts_.size());
+    std::vector<size_t> headLens;
+    size_t total = 0;
+    for (const Part& part : parts_) {
+        size_t before = heads.ReadableBytes();
+        heads.Append("\r\n--");
+        heads.Append(BOUNDARY);
+        heads.Append("\r\n");
+        addContentType_(heads);
+        addContentRange_(heads, part, size);
+        heads.Append("\r\n");
+        headLens.push_back(heads.ReadableBytes() - before);
+        total += headLens.back() + part.len;
+    }
+    tailLen_ = 2 + 2 + BOUNDARY.size() + 4;   // "\r\n--" BOUNDARY "--\r\n"
+    total += tailLen_;
+
+    buffer.Append("Content-type: multipart/byteranges; boundary=");
+    buffer.Append(BOUNDARY);
+    buffer.Append("\r\nContent-length: ");
+    buffer.AppendDecimal(total);
+    buffer.Append("\r\n\r\n");
+    for (size_t i = 0; i < parts_.size(); i++) {
+        size_t before = buffer.ReadableBytes();
+        buffer.Append(heads.ReadPtr(), headLens[i]);
+        heads.Retrieve(headLens[i]);
+        // 第一段之前还有整个响应头
+        parts_[i].headLen = i == 0 ? buffer.ReadableBytes() - start : buffer.ReadableBytes() - before;
     }
-    mmFile_ = (char*)mmRet;
-    close(srcFd);
-    buffer.Append("Content-length: " + std::to_string(mmFileStat_.st_size) + "\r\n\r\n");
+    buffer.Append("\r\n--");
+    buffer.Append(BOUNDARY);
+    buffer.Append("--\r\n");
+    return true;
+}
+
+/*
+解析 "bytes=0-99,200-,-500" 形式的 Range，可满足的区间放入 parts_(偏移与长度)，
+语法错误或区间数超过 MAX_RANGES 时返回 false
+*/
+bool HttpResponse::parseRange_(size_t size) {
+    std::string_view spec = range_;
+    if (spec.size() < 6 || !HttpParser::iequals(spec.substr(0, 6), "bytes=")) { return false; }
+    spec.remove_prefix(6);
+    auto number = [](std::string_view& s, size_t& out) {
+        size_t i = 0;
+        out = 0;
+        for (; i < s.size() && s[i] >= '0' && s[i] <= '9'; i++) {
+            if (out > (SIZE_MAX - 9) / 10) { return false; }
+            out = out * 10 + (s[i] - '0');
+        }
+        s.remove_prefix(i);
+        return i > 0;
+    };
+    int count = 0;
+    while (!spec.empty()) {
+        size_t comma = spec.find(',');
+        std::string_view item = spec.substr(0, comma);
+        spec = comma == std::string_view::npos ? std::string_view() : spec.substr(comma + 1);
+        while (!item.empty() && (item.front() == ' ' || item.front() == '\t')) { item.remove_prefix(1); }
+        while (!item.empty() && (item.back() == ' ' || item.back() == '\t')) { item.remove_suffix(1); }
+        if (item.empty()) { continue; }
+        if (++count > MAX_RANGES) { return false; }
+
+        size_t first = 0, last = 0;
+        if (item.front() == '-') {
+            // 后缀区间：最后 n 字节
+            item.remove_prefix(1);
+            if (!number(item, last) || !item.empty()) { return false; }
+            if (last == 0 || size == 0) { continue; }
+            first = last >= size ? 0 : size - last;
+            last = size - 1;
+        }
+        else {
+            if (!number(item, first) || item.empty() || item.front() != '-') { return false; }
+            item.remove_prefix(1);
+            if (item.empty()) {
+                last = size - 1;
+            }
+            else if (!number(item, last) || !item.empty() || last < first) {
+                return false;
+            }
+            if (first >= size) { continue; }    // 不可满足，跳过
+            last = std::min(last, size - 1);
+        }
+        parts_.push_back({0, first, last - first + 1});
+    }
+    return count > 0;
+}
+
+void HttpResponse::addContentRange_(Buffer& buffer, const Part& part, size_t size) {
+    buffer.Append("Content-Range: bytes ");
+    buffer.AppendDecimal(part.off);
+    buffer.Append("-");
+    buffer.AppendDecimal(part.off + part.len - 1);
+    buffer.Append("/");
+    buffer.AppendDecimal(size);
+    buffer.Append("\r\n");
 }
 
-std::string HttpResponse::getFileType_() {
+const HttpResponse::FileType& HttpResponse::getFileType_() const {
     // 判断文件类型
     std::string::size_type idx = path_.find_last_of('.');
     if (idx == std::string::npos) {
-        return "text/plain";
+        return DEFAULT_TYPE;
     }
-    std::string suffix = path_.substr(idx);
-    if(SUFFIX_TYPE.count(suffix) == 1) {
-        return SUFFIX_TYPE.find(suffix)->second;
+    auto it = SUFFIX_TYPE.find(std::string_view(path_).substr(idx));
+    if (it != SUFFIX_TYPE.end()) {
+        return it->second;
     }
-    return "text/plain";
+    return DEFAULT_TYPE;
 }
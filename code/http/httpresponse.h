@@ -1,11 +1,17 @@
 #pragma once
 
 #include <unordered_map>
+#include <string_view>
+#include <vector>
+#include <time.h>        // gmtime_r, strftime, strptime, timegm
 #include <fcntl.h>       // open
 #include <unistd.h>      // close
 #include <sys/stat.h>    // stat
-#include <sys/mman.h>    // mmap, munmap
 
+#include "filecache.h"
+#include "contentcache.h"
+#include "httpparser.h"
+#include "compressor.h"
 #include "../buffer/buffer.h"
 #include "../log/log.h"
 
@@ -14,38 +20,119 @@ public:
     HttpResponse();
     ~HttpResponse();
 
-    void init(const std::string& srcDir, std::string& path, 
+    void init(std::string_view srcDir, std::string& path, 
             bool isKeepAlive = false, int code = -1);
 
+    // 条件请求头，视图需在 makeResponse 之前有效；命中时响应 304
+    void setConditions(std::string_view ifNoneMatch, std::string_view ifModifiedSince);
+    // Range / If-Range 请求头，同上；满足时响应 206(多个区间为 multipart/byteranges)
+    void setRange(std::string_view range, std::string_view ifRange);
+    // 客户端接受 gzip 时，可压缩的类型发送 gzip 变体
+    void setAcceptGzip(bool acceptGzip);
+
+    /*
+    正文中的一段：先发送 buffer 中接下来的 headLen 字节(响应头或 multipart 分段头)，
+    再发送正文 [off, off + len)
+    */
+    struct Part {
+        size_t headLen;
+        size_t off;
+        size_t len;
+    };
+
+    /*
+    生成响应。一个响应按顺序由以下几段组成：
+        head():   ContentCache 中预生成的响应头，可为空
+        parts():  依次为 buffer 中的 headLen 字节(Date、Connection 等每个请求不同的部分)
+                  与正文的一段；正文为 body() 指向的内存(ContentCache 的正文或 FileCache 的文件映射)，
+                  或 bodyFd() 非负时用 sendfile 从文件发送
+        tailLen(): 最后 buffer 中的字节(multipart 的结束分隔符)
+    holder() 持有以上内存与 fd，调用方需保存到发送完成。
+    */
     void makeResponse(Buffer& buffer);
 
-    void unmapFile();
-    
-    char* file() { return mmFile_; }
-    size_t fileLen() const { return mmFileStat_.st_size; }
+    const std::vector<Part>& parts() const { return parts_; }
+    size_t tailLen() const { return tailLen_; }
+
+    std::string_view head() const;
+    std::string_view body() const;
+    int bodyFd() const;
+    size_t bodyLen() const;
+    std::shared_ptr<const void> holder() const;
+
+    // 释放对缓存的引用
+    void closeFile() {
+        file_.reset();
+        gzFile_.reset();
+        blob_.reset();
+    }
 
     void errorContent(Buffer& buffer, std::string message);
 
+    // 预加载 400/403/404 错误页面(依赖已初始化的 FileCache)
+    static void loadErrorPages();
+
     int code() const { return code_; }
 
 
 private:
     void errorHtml_();
+    bool errorPage_(Buffer& buffer, size_t start);
+    static std::string errorBody_(int code, const std::string& message);
+    bool loadBlob_();
+    bool loadGzip_();
+    std::string blobHead_(size_t bodyLen);
     void addStateLine_(Buffer& buffer);
     void addHeader_(Buffer& buffer);
+    void addContentType_(Buffer& buffer);
+    void addValidators_(Buffer& buffer);
     void addContent_(Buffer& buffer);
+    bool notModified_();
+    bool makeRange_(Buffer& buffer, size_t start);
+    bool parseRange_(size_t size);
+    void addContentRange_(Buffer& buffer, const Part& part, size_t size);
+
+    struct FileType {
+        std::string_view type;          // MIME 类型
+        std::string_view cacheControl;  // Cache-Control 策略
+        bool compress;                  // 是否发送 gzip 变体
+    };
+    const FileType& getFileType_() const;
+    static std::string_view date_();
 
-    std::string getFileType_();
+    // 正文所在的文件：发送大的 .gz 兄弟文件时是它，否则是请求的文件
+    const FileCache::EntryPtr& bodyFile_() const { return gzFile_ ? gzFile_ : file_; }
+    // 有可发送的文件体(mmap 的或只有 fd 走 sendfile 的)
+    bool hasBody_() const { return bodyFile_() && bodyFile_()->fd >= 0 && bodyFile_()->st.st_size > 0; }
 
     int code_; // HTTP状态码
     bool isKeepAlive_;  // 是否保持连接
     std::string path_;  // 请求文件路径
     std::string srcDir_;    // 请求文件目录
+    std::string_view ifNoneMatch_;
+    std::string_view ifModifiedSince_;
+    std::string_view range_;
+    std::string_view ifRange_;
+    bool acceptGzip_;
+    bool gzip_;         // 发送的是 gzip 变体
+    std::string gzPath_;    // path_ + ".gz"，复用容量
+
+    std::vector<Part> parts_;
+    size_t tailLen_;
+
+    FileCache::EntryPtr file_;  // 来自 FileCache 的 stat 结果与文件映射
+    FileCache::EntryPtr gzFile_;    // 不小于 ContentCache::MAX_OBJECT 的 .gz 兄弟文件，像普通文件一样映射或 sendfile 发送
+    ContentCache::BlobPtr blob_;    // 小文件的预生成响应头与正文
 
-    char* mmFile_;  // mmap 映射的文件内存地址
-    struct stat mmFileStat_;
+    static const int MAX_RANGES = 16;   // 超过时忽略 Range，防止大量小区间放大开销
+    // 只对大小在 [GZIP_MIN, GZIP_MAX] 内的文件做后台压缩：太小不值得，太大压缩耗时；预压缩的 .gz 文件只要求不小于 GZIP_MIN
+    static const size_t GZIP_MIN = 256;
+    static const size_t GZIP_MAX = 4 * 1024 * 1024;
 
-    static const std::unordered_map<std::string, std::string> SUFFIX_TYPE;
-    static const std::unordered_map<int, std::string> CODE_STATUS;
+    static const FileType DEFAULT_TYPE;
+    static const std::unordered_map<std::string_view, FileType> SUFFIX_TYPE;
+    static const std::unordered_map<int, std::string_view> CODE_STATUS;
+    static const std::unordered_map<int, std::string_view> STATUS_LINE;
     static const std::unordered_map<int, std::string> CODE_PATH;
+    static std::unordered_map<int, ContentCache::BlobPtr> ERROR_PAGES;  // 启动后只读
 };
\ No newline at end of file
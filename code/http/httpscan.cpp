@@ -0,0 +1,135 @@
+#include "httpscan.h"
+
+#include <cstring>
+#include <immintrin.h>
+
+namespace {
+
+/* ---------------- 标量实现，也用于处理 SIMD 剩余的尾部 ---------------- */
+
+const char* findCharsScalar(const char* p, const char* end, const char* set, size_t setLen) {
+    for (; p < end; p++) {
+        if (memchr(set, *p, setLen)) { return p; }
+    }
+    return end;
+}
+
+template <bool SPACE>
+const char* findCtlScalar(const char* p, const char* end) {
+    for (; p < end; p++) {
+        unsigned char ch = *p;
+        bool hit = ch < 0x20 ? (SPACE || ch != '\t') : (ch == 0x7f || (SPACE && ch == ' '));
+        if (hit) { return p; }
+    }
+    return end;
+}
+
+/* ---------------- SSE4.2: pcmpestri 一次比较 16 字节 ---------------- */
+
+__attribute__((target("sse4.2")))
+const char* findCharsSse42(const char* p, const char* end, const char* set, size_t setLen) {
+    char buf[16] = {0};
+    memcpy(buf, set, setLen);
+    const __m128i needle = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf));
+    const int n = static_cast<int>(setLen);
+    for (; end - p >= 16; p += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        int idx = _mm_cmpestri(needle, n, x, 16,
+                _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_LEAST_SIGNIFICANT);
+        if (idx < 16) { return p + idx; }
+    }
+    return findCharsScalar(p, end, set, setLen);
+}
+
+template <bool SPACE>
+__attribute__((target("sse4.2")))
+const char* findCtlSse42(const char* p, const char* end) {
+    // 区间对：[0x00, 0x08] [0x0a, 0x1f] [0x7f, 0x7f]，或 [0x00, 0x20] [0x7f, 0x7f]
+    static const char CTL[16] = {0x00, 0x08, 0x0a, 0x1f, 0x7f, 0x7f};
+    static const char SPACE_CTL[16] = {0x00, 0x20, 0x7f, 0x7f};
+    const __m128i ranges = _mm_loadu_si128(reinterpret_cast<const __m128i*>(SPACE ? SPACE_CTL : CTL));
+    const int n = SPACE ? 4 : 6;
+    for (; end - p >= 16; p += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        int idx = _mm_cmpestri(ranges, n, x, 16,
+                _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_LEAST_SIGNIFICANT);
+        if (idx < 16) { return p + idx; }
+    }
+    return findCtlScalar<SPACE>(p, end);
+}
+
+/* ---------------- AVX2: 一次比较 32 字节 ---------------- */
+
+__attribute__((target("avx2")))
+const char* findCharsAvx2(const char* p, const char* end, const char* set, size_t setLen) {
+    __m256i needles[HttpScan::MAX_SET];
+    for (size_t i = 0; i < setLen; i++) {
+        needles[i] = _mm256_set1_epi8(set[i]);
+    }
+    for (; end - p >= 32; p += 32) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i hit = _mm256_cmpeq_epi8(x, needles[0]);
+        for (size_t i = 1; i < setLen; i++) {
+            hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(x, needles[i]));
+        }
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hit));
+        if (mask) { return p + __builtin_ctz(mask); }
+    }
+    return findCharsScalar(p, end, set, setLen);
+}
+
+template <bool SPACE>
+__attribute__((target("avx2")))
+const char* findCtlAvx2(const char* p, const char* end) {
+    // 无符号 x <= limit  <=>  min(x, limit) == x
+    const __m256i limit = _mm256_set1_epi8(SPACE ? 0x20 : 0x1f);
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i del = _mm256_set1_epi8(0x7f);
+    for (; end - p >= 32; p += 32) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i hit = _mm256_cmpeq_epi8(_mm256_min_epu8(x, limit), x);
+        if (!SPACE) {
+            hit = _mm256_andnot_si256(_mm256_cmpeq_epi8(x, tab), hit);
+        }
+        hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(x, del));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hit));
+        if (mask) { return p + __builtin_ctz(mask); }
+    }
+    return findCtlScalar<SPACE>(p, end);
+}
+
+} // namespace
+
+HttpScan::Impl HttpScan::impl_ = HttpScan::select_(
+        supported_(AVX2) ? AVX2 : (supported_(SSE42) ? SSE42 : SCALAR));
+
+bool HttpScan::supported_(KERNEL kernel) {
+    __builtin_cpu_init();
+    switch (kernel) {
+        case AVX2: return __builtin_cpu_supports("avx2");
+        case SSE42: return __builtin_cpu_supports("sse4.2");
+        default: return true;
+    }
+}
+
+HttpScan::Impl HttpScan::select_(KERNEL kernel) {
+    switch (kernel) {
+        case AVX2: return {AVX2, findCharsAvx2, findCtlAvx2<false>, findCtlAvx2<true>};
+        case SSE42: return {SSE42, findCharsSse42, findCtlSse42<false>, findCtlSse42<true>};
+        default: return {SCALAR, findCharsScalar, findCtlScalar<false>, findCtlScalar<true>};
+    }
+}
+
+bool HttpScan::setKernel(KERNEL kernel) {
+    if (!supported_(kernel)) { return false; }
+    impl_ = select_(kernel);
+    return true;
+}
+
+const char* HttpScan::kernelName(KERNEL kernel) {
+    switch (kernel) {
+        case AVX2: return "avx2";
+        case SSE42: return "sse4.2";
+        default: return "scalar";
+    }
+}
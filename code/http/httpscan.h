@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <assert.h>
+
+/*
+HTTP 解析用到的分隔符扫描内核：AVX2 / SSE4.2 / 标量三套实现，
+进程启动时按 CPU 支持情况选择最快的一套(不依赖编译选项 -mavx2)。
+所有函数在 [begin, end) 内查找，找不到返回 end，不会读越界。
+*/
+class HttpScan {
+public:
+    enum KERNEL {
+        SCALAR = 0,
+        SSE42,
+        AVX2,
+    };
+
+    // 第一个属于 set 的字符，set 至多 MAX_SET 个字符
+    static const char* findChars(const char* begin, const char* end,
+            const char* set, size_t setLen) {
+        assert(setLen > 0 && setLen <= MAX_SET);
+        return impl_.findChars(begin, end, set, setLen);
+    }
+
+    // 第一个控制字符(0x00-0x1f 中除 HTAB 以外，以及 0x7f)，用于头部值找 '\r'
+    static const char* findCtl(const char* begin, const char* end) {
+        return impl_.findCtl(begin, end);
+    }
+
+    // 第一个空格或控制字符(0x00-0x20、0x7f)，用于请求目标
+    static const char* findSpaceOrCtl(const char* begin, const char* end) {
+        return impl_.findSpaceOrCtl(begin, end);
+    }
+
+    static KERNEL kernel() { return impl_.kernel; }
+    static const char* kernelName(KERNEL kernel);
+
+    // 强制使用指定内核(测试/性能对比用)，CPU 不支持时返回 false
+    static bool setKernel(KERNEL kernel);
+
+    static const size_t MAX_SET = 16;
+
+private:
+    struct Impl {
+        KERNEL kernel;
+        const char* (*findChars)(const char*, const char*, const char*, size_t);
+        const char* (*findCtl)(const char*, const char*);
+        const char* (*findSpaceOrCtl)(const char*, const char*);
+    };
+
+    static bool supported_(KERNEL kernel);
+    static Impl select_(KERNEL kernel);
+
+    static Impl impl_;
+};
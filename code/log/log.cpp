@@ -1,189 +1,635 @@
 #include "log.h"
-#include "blockqueue.h"
 #include <cstdio>
 #include <memory>
 #include <mutex>
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>      // open, fallocate
+#include <limits.h>     // IOV_MAX
+#include <unistd.h>
 
 Log::Log() {
     //std::cout << "Log Constructed!" << std::endl;
     lineCount_ = 0;
+    fileLines_ = 0;
+    isOpen_ = false;
+    level_ = 1;
     isAsync_ = false;
+    isDeferred_ = false;
+    isBinary_ = false;
+    fileStarted_ = false;
+    ringSize_ = 0;
     writeThread_ = nullptr;
-    deque_ = nullptr;
     toDay_ = 0;
-    fp_ = nullptr;
+    fd_ = -1;
+    fileBytes_ = 0;
+    nextFd_ = -1;
+    flushIntervalMs_ = FLUSH_INTERVAL_MS;
+    fsyncIntervalMs_ = 0;
+    overflow_ = BLOCK;
+    sampleN_ = 10;
+    dropped_ = 0;
+    sampled_ = 0;
+    droppedReported_ = 0;
+    sampledReported_ = 0;
+    lastSummary_ = std::chrono::steady_clock::now();
+    wakeup_ = false;
+    flushRequested_ = 0;
+    flushDone_ = 0;
+    isClose_ = false;
 }
 
 Log::~Log() {
     if (writeThread_ && writeThread_->joinable()) {
-        while(!deque_->empty()) {
-            deque_->flush();
+        {
+            std::lock_guard<std::mutex> locker(condMtx_);
+            isClose_ = true;
         }
-        deque_->close();
-        writeThread_->join();
+        writerCond_.notify_one();
+        writeThread_->join();   // 写日志线程退出前写完所有环
     }
-    if (fp_) {
-        std::lock_guard<std::mutex> locker(mtx_);
-        flush();
-        fclose(fp_);
-    }
-}
-
-int Log::GetLevel() {
-    std::lock_guard<std::mutex> locker(mtx_);
-    return level_;
-}
-
-void Log::SetLevel(int level) {
     std::lock_guard<std::mutex> locker(mtx_);
-    level_ = level;
+    CloseFile(fd_);
+    DiscardNext();
 }
 
-void Log::init(int level = 1, const char* path, const char* suffix, int maxQueueCapacity) {
-    isOpen_ = true;
+void Log::init(int level = 1, const char* path, const char* suffix, int maxQueueCapacity,
+        FORMAT_MODE format) {
+    // 切换文件或模式之前，已提交的日志先写进旧文件
+    if (writeThread_) {
+        flush();
+    }
     level_ = level;
     if (maxQueueCapacity > 0) {
-        isAsync_ = true;
-        if (!deque_) {
-            auto newDeque = std::make_unique<BlockDeque<std::string>>();
-            deque_ = move(newDeque);
-
-            auto newThread = std::make_unique<std::thread>(FlushLogThread);
-            writeThread_ = move(newThread);
+        // 队列容量按每行约 128 字节折算成每个线程的环大小，向上取 2 的幂
+        size_t want = std::max<size_t>(static_cast<size_t>(maxQueueCapacity) * 128, 64 * 1024);
+        size_t size = 1;
+        while (size < want) { size <<= 1; }
+        ringSize_ = size;
+        if (!writeThread_) {
+            writeThread_ = std::make_unique<std::thread>(FlushLogThread);
         }
+        isAsync_ = true;
     }
     else {
         isAsync_ = false;
     }
+    // 延迟格式化依赖写日志线程，同步模式下总是文本
+    isDeferred_ = isAsync_ && format != TEXT;
 
-    lineCount_ = 0;
     time_t timer = time(nullptr);
-    struct tm *sysTime = localtime(&timer);
-    struct tm t = *sysTime;
-    path_ = path;
-    suffix_ = suffix;
-    char fileName[LOG_NAME_LEN] = {0};
-    snprintf(fileName, LOG_NAME_LEN - 1, "%s/%04d_%02d_%02d%s",
-            path_, t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, suffix_);
-    toDay_ = t.tm_mday;
-
+    struct tm t;
+    localtime_r(&timer, &t);
     {
         std::lock_guard<std::mutex> locker(mtx_);
-        buff_.RetrieveAll();
-        if(fp_) {
-            flush();
-            fclose(fp_);
-        }
-        fp_ = fopen(fileName, "a");
-        if (fp_ == nullptr) {
-            mkdir(path_, 0777);
-            fp_ = fopen(fileName, "a");
-        }
-        assert(fp_ != nullptr);
+        CloseFile(fd_);
+        DiscardNext();
+        path_ = path;
+        suffix_ = suffix;
+        char fileName[LOG_NAME_LEN];
+        FileName(fileName, t, 0);
+        fd_ = OpenFile(fileName);
+        assert(fd_ >= 0);
+        lineCount_ = 0;
+        fileLines_ = 0;
+        fileBytes_ = 0;
+        toDay_ = t.tm_mday;
+        isBinary_ = isAsync_ && format == BINARY;
+        fileStarted_ = false;
+        lastSync_ = std::chrono::steady_clock::now();
     }
+    isOpen_ = true;
+}
+
+void Log::SetFlushInterval(int flushIntervalMs, int fsyncIntervalMs) {
+    flushIntervalMs_ = std::max(flushIntervalMs, 1);
+    fsyncIntervalMs_ = std::max(fsyncIntervalMs, 0);
+}
+
+void Log::SetOverflowPolicy(OVERFLOW_POLICY policy, int sampleN) {
+    overflow_ = policy;
+    sampleN_ = std::max(sampleN, 1);
 }
 
 void Log::write(int level, const char *format, ...) {
-    // 获取时间戳
-    struct timeval now = {0, 0};
-    gettimeofday(&now, nullptr);
-    time_t tSec = now.tv_sec;
-    struct tm* sysTime = localtime(&tSec);
-    struct tm t = *sysTime;
+    // 获取时间戳：clock_gettime 走 vDSO，不进内核
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    // 在本线程的栈上格式化整行，不碰任何共享状态；日期时间部分每秒只格式化一次
+    // YYYY-MM-DD HH:MM:SS.uuuuuu [level]: message\n
+    // e.g.: 2025-12-14 15:42:10.267310 [debug]: This is a debug message
+    char line[LINE_SIZE];
+    const struct tm& t = LogTime::Format(now.tv_sec, now.tv_nsec / 1000, line);
+    int n = LogTime::LENGTH;
+    const char* title = LogRecord::LevelTitle(level);
+    size_t titleLen = strlen(title);
+    memcpy(line + n, title, titleLen);
+    n += titleLen;
     va_list vaList;
+    va_start(vaList, format);
+    int m = vsnprintf(line + n, sizeof(line) - n - 1, format, vaList);
+    va_end(vaList);
+    n += std::min<int>(std::max(m, 0), sizeof(line) - n - 2);  // 超长时截断
+    line[n++] = '\n';
 
-    // 新建文件检测
-    // 跨天 or 行数超过最大限制
-    if (toDay_ != t.tm_mday || (lineCount_ && (lineCount_ % MAX_LINES == 0))) {
-        std::unique_lock<std::mutex> locker(mtx_);
-        locker.unlock();
+    // 同步/异步模式 分支点
+    if (!isAsync_) {
+        struct iovec iov = {line, static_cast<size_t>(n)};
+        std::lock_guard<std::mutex> locker(mtx_);
+        WriteToFile(&iov, 1, t);
+        SyncIfDue();
+        return;
+    }
+    Push(level, line, n);
+}
 
-        char newFile[LOG_NAME_LEN]; // 存储完整的日志文件路径（目录路径 + 文件名 + 后缀）
-        char tail[36] = {0};    // 存储格式化的日期字符串: YYYY_MM_DD
-        snprintf(tail, 36, "%04d_%02d_%02d", t.tm_year + 1900, t.tm_mon + 1, t.tm_mday);
+/* 整条日志(文本行或二进制记录)放进本线程的环，环满时按 overflow_ 处理 */
+void Log::Push(int level, const char* data, size_t len) {
+    LogRing* ring = LocalRing();
+    int policy = overflow_.load(std::memory_order_relaxed);
+    // 环用量不到一半时任何策略都直接写入，计数和判断只在有压力时发生
+    if (policy != BLOCK && ring->used() > ring->capacity() / 2 && !Admit(ring, level, policy)) {
+        WakeWriter();
+        return;
+    }
+    while (!ring->push(data, len)) {
+        if (policy == DROP_NEWEST || policy == SAMPLE || (policy == DROP_BY_LEVEL && level < 2)) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            WakeWriter();
+            return;
+        }
+        // 环满：唤醒写日志线程，等它腾出空间
+        std::unique_lock<std::mutex> locker(condMtx_);
+        wakeup_ = true;
+        writerCond_.notify_one();
+        spaceCond_.wait_for(locker, std::chrono::milliseconds(FLUSH_INTERVAL_MS));
+    }
+    // 过半时提前唤醒
+    if (ring->used() > ring->capacity() / 2) {
+        WakeWriter();
+    }
+}
 
-        if (toDay_ != t.tm_mday) {
-            snprintf(newFile, LOG_NAME_LEN - 72, "%s/%s%s", path_, tail, suffix_);
-            // warning：这里未加锁，修改了共享变量
-            toDay_ = t.tm_mday;
-            lineCount_ = 0;
+/* 环已过半：按策略决定这一行是否写入，不写入的计数 */
+bool Log::Admit(LogRing* ring, int level, int policy) {
+    if (policy == SAMPLE) {
+        static thread_local uint32_t seq = 0;
+        if (++seq % static_cast<uint32_t>(sampleN_.load(std::memory_order_relaxed)) != 0) {
+            sampled_.fetch_add(1, std::memory_order_relaxed);
+            return false;
         }
-        else {
-            snprintf(newFile, LOG_NAME_LEN - 72, "%s/%s-%d%s", 
-            path_, tail, (lineCount_  / MAX_LINES), suffix_);
+    }
+    else if (policy == DROP_BY_LEVEL && level < 2 && ring->used() > ring->capacity() / 4 * 3) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);   // 留出最后 1/4 给 warn/error
+        return false;
+    }
+    return true;
+}
+
+/* 写日志线程空闲时 notify 才有意义，多余的唤醒用 wakeup_ 合并 */
+void Log::WakeWriter() {
+    if (!wakeup_.exchange(true)) {
+        writerCond_.notify_one();
+    }
+}
+
+const LogFormat* Log::RegisterFormat(int level, const char* format) {
+    std::unique_ptr<LogFormat> fmt = std::make_unique<LogFormat>();
+    fmt->level = level;
+    fmt->format = format;
+    LogRecord::ParseLimits(format, fmt->strLimit);
+    std::lock_guard<std::mutex> locker(formatMtx_);
+    fmt->id = static_cast<uint32_t>(formats_.size());
+    formats_.push_back(std::move(fmt));
+    return formats_.back().get();
+}
+
+/* 本线程的环，第一次写日志时创建并登记；线程退出时标记关闭，由写日志线程写完后回收 */
+LogRing* Log::LocalRing() {
+    struct Holder {
+        std::shared_ptr<LogRing> ring;
+        ~Holder() { if (ring) { ring->close(); } }
+    };
+    static thread_local Holder holder;
+    if (!holder.ring) {
+        holder.ring = std::make_shared<LogRing>(ringSize_);
+        std::lock_guard<std::mutex> locker(ringMtx_);
+        rings_.push_back(holder.ring);
+    }
+    return holder.ring.get();
+}
+
+/*
+所有环中已提交的数据以 iovec 形式放进 segs，不拷贝；taken 记下每个环取了多少，写完后再 consume。
+已关闭且写空的环在这里回收，环只会被写日志线程自己删除，taken 中的指针在写完之前一直有效
+*/
+void Log::DrainRings(std::vector<struct iovec>& segs, std::vector<std::pair<LogRing*, size_t>>& taken) {
+    std::lock_guard<std::mutex> locker(ringMtx_);
+    for (auto it = rings_.begin(); it != rings_.end(); ) {
+        LogRing* ring = it->get();
+        bool closed = ring->closed();   // 先看关闭标记，再取数据，不会漏掉关闭前的最后几行
+        struct iovec iov[2];
+        int cnt = ring->peek(iov);
+        if (closed && cnt == 0) {
+            it = rings_.erase(it);
+            continue;
         }
+        size_t len = 0;
+        for (int i = 0; i < cnt; i++) {
+            segs.push_back(iov[i]);
+            len += iov[i].iov_len;
+        }
+        if (len > 0) {
+            taken.emplace_back(ring, len);
+        }
+        ++it;
+    }
+}
 
-        locker.lock();
-        flush();
-        fclose(fp_);    // 关闭旧文件
-        fp_ = fopen(newFile, "a");  // 打开新文件
-        assert(fp_ != nullptr);
+/* 把批缓冲区中的二进制记录格式化成文本行，文本行原样保留；只在写日志线程调用 */
+void Log::Expand(const std::string& batch, std::string& text) {
+    const char* p = batch.data();
+    const char* end = p + batch.size();
+    while (p < end) {
+        if (static_cast<uint8_t>(*p) == LogRecord::MARK_RECORD) {
+            uint32_t size = LogRecord::Load<uint32_t>(p + 1);
+            const LogFormat* fmt = LogRecord::Load<const LogFormat*>(p + 5);
+            uint64_t tick = LogRecord::Load<uint64_t>(p + 13);
+            LogRecord::AppendPrefix(clock_.ToMicros(tick), fmt->level, text);
+            LogRecord::AppendMessage(fmt->format, p + LogRecord::RING_HEADER,
+                    size - LogRecord::RING_HEADER, text);
+            text.push_back('\n');
+            p += size;
+        }
+        else {
+            const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+            eol = eol ? eol + 1 : end;
+            text.append(p, eol - p);
+            p = eol;
+        }
     }
+}
 
-    // 将日志内容格式化到 Buffer
-    {
-        std::lock_guard<std::mutex> locker(mtx_);
+/*
+二进制文件：环中记录的格式串地址换成 id、TSC 计数换成微秒时间戳后写入，
+每个文件以文件头开始，格式串在文件中第一次用到时写一次。调用方持有 mtx_
+*/
+void Log::WriteBinary(const std::string& batch, const struct tm& t) {
+    std::string out;
+    out.reserve(batch.size() + 64);
+    const char* p = batch.data();
+    const char* end = p + batch.size();
+    while (p < end) {
+        if (toDay_ != t.tm_mday || fileLines_ >= MAX_LINES) {
+            struct iovec iov = {out.data(), out.size()};
+            WriteAll(&iov, 1);
+            out.clear();
+            Rotate(t);
+        }
+        if (!fileStarted_) {
+            out.push_back(static_cast<char>(LogRecord::MARK_START));
+            out.append(LogRecord::FILE_MAGIC, sizeof(LogRecord::FILE_MAGIC) - 1);
+            fileFormats_.clear();
+            fileStarted_ = true;
+        }
+        char header[LogRecord::FILE_HEADER];
+        if (static_cast<uint8_t>(*p) == LogRecord::MARK_RECORD) {
+            uint32_t size = LogRecord::Load<uint32_t>(p + 1);
+            const LogFormat* fmt = LogRecord::Load<const LogFormat*>(p + 5);
+            uint64_t tick = LogRecord::Load<uint64_t>(p + 13);
+            if (fmt->id >= fileFormats_.size()) { fileFormats_.resize(fmt->id + 1, false); }
+            if (!fileFormats_[fmt->id]) {
+                uint32_t len = static_cast<uint32_t>(strlen(fmt->format));
+                char entry[10];
+                entry[0] = static_cast<char>(LogRecord::MARK_FORMAT);
+                LogRecord::Store(entry + 1, fmt->id);
+                entry[5] = static_cast<char>(fmt->level);
+                LogRecord::Store(entry + 6, len);
+                out.append(entry, sizeof(entry));
+                out.append(fmt->format, len);
+                fileFormats_[fmt->id] = true;
+            }
+            uint32_t argLen = size - LogRecord::RING_HEADER;
+            header[0] = static_cast<char>(LogRecord::MARK_RECORD);
+            LogRecord::Store(header + 1, static_cast<uint32_t>(LogRecord::FILE_HEADER + argLen));
+            LogRecord::Store(header + 5, fmt->id);
+            LogRecord::Store(header + 9, clock_.ToMicros(tick));
+            out.append(header, sizeof(header));
+            out.append(p + LogRecord::RING_HEADER, argLen);
+            p += size;
+        }
+        else {
+            const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+            eol = eol ? eol + 1 : end;
+            header[0] = static_cast<char>(LogRecord::MARK_TEXT);
+            LogRecord::Store(header + 1, static_cast<uint32_t>(eol - p));
+            out.append(header, 5);
+            out.append(p, eol - p);
+            p = eol;
+        }
+        fileLines_++;
         lineCount_++;
-        // YYYY-MM-DD HH:MM:SS.uuuuuu (精确到微秒)
-        // e.g.: 2025-12-14 15:42:10.267310
-        int n = snprintf(buff_.WritePtr(), 128, "%d-%02d-%02d %02d:%02d:%02d.%06ld ",
-                    t.tm_year + 1900, t.tm_mon + 1, t.tm_mday,
-                    t.tm_hour, t.tm_min, t.tm_sec, now.tv_usec);
-        buff_.HasWritten(n);
-        // e.g.: 2025-12-14 15:42:10.267310 [debug]: 
-        AppendLogLevelTitle(level);
+    }
+    struct iovec iov = {out.data(), out.size()};
+    WriteAll(&iov, 1);
+    PrepareNext(t);
+}
+
+/* index 为 0 时是当天的第一个文件：path/YYYY_MM_DD.suffix，之后是 path/YYYY_MM_DD-index.suffix */
+void Log::FileName(char* name, const struct tm& t, int index) {
+    if (index == 0) {
+        snprintf(name, LOG_NAME_LEN - 1, "%s/%04d_%02d_%02d%s",
+                path_, t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, suffix_);
+    }
+    else {
+        snprintf(name, LOG_NAME_LEN - 1, "%s/%04d_%02d_%02d-%d%s",
+                path_, t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, index, suffix_);
+    }
+}
+
+int Log::OpenFile(const char* name) {
+    int fd = open(name, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
+    if (fd < 0) {
+        mkdir(path_, 0777);
+        fd = open(name, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
+    }
+    return fd;
+}
+
+/* 截到实际长度，释放 fallocate 预留而没用上的空间 */
+void Log::CloseFile(int fd) {
+    if (fd < 0) {
+        return;
+    }
+    if (fsyncIntervalMs_ > 0) {
+        fdatasync(fd);
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0) {
+        ftruncate(fd, st.st_size);
+    }
+    close(fd);
+}
+
+/*
+当前文件写到 MAX_LINES 的 3/4 时提前打开下一个文件，按当前文件的平均行长预留空间
+(FALLOC_FL_KEEP_SIZE：文件长度不变，追加写直接落在预留的块上)，换文件时只需换 fd
+*/
+void Log::PrepareNext(const struct tm& t) {
+    if (nextFd_ >= 0 || fileLines_ < MAX_LINES / 4 * 3) {
+        return;
+    }
+    char name[LOG_NAME_LEN];
+    FileName(name, t, lineCount_ / MAX_LINES + 1);
+    nextFd_ = OpenFile(name);
+    if (nextFd_ < 0) {
+        return;
+    }
+    nextName_ = name;
+    if (fileBytes_ > 0) {
+        off_t expect = static_cast<off_t>(fileBytes_ / fileLines_) * MAX_LINES;
+        fallocate(nextFd_, FALLOC_FL_KEEP_SIZE, 0, expect);
+    }
+}
 
-        va_start(vaList, format);
-        // e.g.: 2025-12-14 15:42:10.267310 [debug]: This is a debug message in sync mode
-        int m = vsnprintf(buff_.WritePtr(), buff_.WritableBytes(), format, vaList);
-        va_end(vaList);
+/* 提前打开的文件没用上(跨天或重新 init)：关闭，是本进程新建的空文件就删掉 */
+void Log::DiscardNext() {
+    if (nextFd_ < 0) {
+        return;
+    }
+    struct stat st;
+    bool empty = fstat(nextFd_, &st) == 0 && st.st_size == 0;
+    CloseFile(nextFd_);
+    if (empty) {
+        unlink(nextName_.c_str());
+    }
+    nextFd_ = -1;
+}
+
+/* 跨天或当前文件行数达到上限时换文件，调用方持有 mtx_ */
+void Log::Rotate(const struct tm& t) {
+    if (toDay_ == t.tm_mday && fileLines_ < MAX_LINES) {
+        return;
+    }
+    int index = 0;
+    if (toDay_ != t.tm_mday) {
+        toDay_ = t.tm_mday;
+        lineCount_ = 0;
+    }
+    else {
+        index = lineCount_ / MAX_LINES;
+    }
+    char newFile[LOG_NAME_LEN]; // 存储完整的日志文件路径（目录路径 + 文件名 + 后缀）
+    FileName(newFile, t, index);
+    CloseFile(fd_);    // 关闭旧文件
+    if (nextFd_ >= 0 && nextName_ == newFile) {
+        fd_ = nextFd_;  // 提前打开的文件
+        nextFd_ = -1;
+    }
+    else {
+        DiscardNext();
+        fd_ = OpenFile(newFile);
+    }
+    fileLines_ = 0;
+    fileBytes_ = 0;
+    fileStarted_ = false;
+}
 
-        buff_.HasWritten(m);
-        buff_.Append("\n\0", 2);
+/* 写完整组 iovec：每次至多 IOV_MAX 个，处理部分写；出错时放弃这一批，不阻塞写日志线程 */
+void Log::WriteAll(struct iovec* iov, size_t cnt) {
+    while (cnt > 0) {
+        ssize_t n = writev(fd_, iov, static_cast<int>(std::min<size_t>(cnt, IOV_MAX)));
+        if (n < 0) {
+            if (errno == EINTR) { continue; }
+            return;
+        }
+        fileBytes_ += n;
+        while (cnt > 0 && static_cast<size_t>(n) >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            cnt--;
+        }
+        if (cnt > 0) {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + n;
+            iov->iov_len -= n;
+        }
+    }
+}
 
-        // 同步/异步模式 分支点
-        if(isAsync_ && deque_ && !deque_->full()) {
-            deque_->push_back(buff_.RetrieveAllToStr());
-        } else {
-            fputs(buff_.ReadPtr(), fp_);
+/*
+按行写入当前文件：数据原地切分成 iovec，一次 writev；写满 MAX_LINES 行就在行边界处
+先把前面的部分写出去再换文件。调用方持有 mtx_
+*/
+void Log::WriteToFile(struct iovec* iov, size_t cnt, const struct tm& t) {
+    iov_.clear();
+    for (size_t i = 0; i < cnt; i++) {
+        const char* p = static_cast<const char*>(iov[i].iov_base);
+        const char* end = p + iov[i].iov_len;
+        while (p < end) {
+            if (toDay_ != t.tm_mday || fileLines_ >= MAX_LINES) {
+                WriteAll(iov_.data(), iov_.size());
+                iov_.clear();
+                Rotate(t);
+            }
+            // 环绕回时一行可能跨两段，只在遇到 '\n' 时计数
+            const char* q = p;
+            while (q < end && fileLines_ < MAX_LINES) {
+                const char* eol = static_cast<const char*>(memchr(q, '\n', end - q));
+                if (eol == nullptr) {
+                    q = end;
+                    break;
+                }
+                q = eol + 1;
+                fileLines_++;
+                lineCount_++;
+            }
+            iov_.push_back({const_cast<char*>(p), static_cast<size_t>(q - p)});
+            p = q;
         }
-        buff_.RetrieveAll();
     }
+    WriteAll(iov_.data(), iov_.size());
+    PrepareNext(t);
 }
 
-void Log::AppendLogLevelTitle(int level) {
-    switch(level) {
-        case 0:
-            buff_.Append("[debug]: ", 9);
-            break;
-        case 1:
-            buff_.Append("[info] : ", 9);
-            break;
-        case 2:
-            buff_.Append("[warn] : ", 9);
-            break;
-        case 3:
-            buff_.Append("[error]: ", 9);
-            break;
-        default:
-            buff_.Append("[info] : ", 9);
-            break;
+/*
+距上次汇总超过 SUMMARY_INTERVAL_MS(或 force，退出前)且期间有丢弃或抽样时，写一行 [warn] 汇总；
+只在写日志线程调用，调用方持有 mtx_
+*/
+void Log::WriteSummary(bool force) {
+    uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+    uint64_t sampled = sampled_.load(std::memory_order_relaxed);
+    if (dropped == droppedReported_ && sampled == sampledReported_) {
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (now - lastSummary_ < std::chrono::milliseconds(SUMMARY_INTERVAL_MS) && !force) {
+        return;
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    char line[256];
+    const struct tm& t = LogTime::Format(ts.tv_sec, ts.tv_nsec / 1000, line);
+    int n = LogTime::LENGTH;
+    n += snprintf(line + n, sizeof(line) - n,
+            "%sLog overflow: dropped %llu, sampled out %llu lines in the last %llds "
+            "(total dropped %llu, sampled out %llu)\n", LogRecord::LevelTitle(2),
+            static_cast<unsigned long long>(dropped - droppedReported_),
+            static_cast<unsigned long long>(sampled - sampledReported_),
+            static_cast<long long>(std::chrono::duration_cast<std::chrono::seconds>(now - lastSummary_).count()),
+            static_cast<unsigned long long>(dropped), static_cast<unsigned long long>(sampled));
+    if (isBinary_) {
+        WriteBinary(std::string(line, n), t);   // 二进制文件中作为文本行
+    }
+    else {
+        struct iovec iov = {line, static_cast<size_t>(n)};
+        WriteToFile(&iov, 1, t);
+    }
+    droppedReported_ = dropped;
+    sampledReported_ = sampled;
+    lastSummary_ = now;
+}
+
+/* 距上次 fdatasync 超过 fsyncIntervalMs_ 时再做一次；调用方持有 mtx_ */
+void Log::SyncIfDue() {
+    int interval = fsyncIntervalMs_;
+    if (interval <= 0) {
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (now - lastSync_ >= std::chrono::milliseconds(interval)) {
+        fdatasync(fd_);
+        lastSync_ = now;
     }
 }
 
 void Log::flush() {
-    if (isAsync_) {
-        deque_->flush();
+    if (writeThread_) {
+        std::unique_lock<std::mutex> locker(condMtx_);
+        uint64_t target = ++flushRequested_;
+        writerCond_.notify_one();
+        flushCond_.wait(locker, [&] { return flushDone_ >= target || isClose_; });
     }
-    fflush(fp_);
 }
 
+/*
+写日志线程：每 flushIntervalMs_ 或被唤醒时收集一轮，整批写入文件。
+文本日志直接从环里 writev，只有需要改写的二进制记录才拷贝到批缓冲区；
+业务线程写的是各自的环，写日志线程收集、写文件期间它们照常写入，不会互相等待
+*/
 void Log::AsyncWrite() {
-    std::string str = "";
-    while(deque_->pop(str)) {
-        std::lock_guard<std::mutex> locker(mtx_);
-        fputs(str.c_str(), fp_);
-        //fflush(fp_);
+    std::vector<struct iovec> segs;
+    std::vector<std::pair<LogRing*, size_t>> taken;
+    std::string batch;  // 二进制记录，复用容量
+    std::string text;   // 二进制记录格式化后的文本
+    while (true) {
+        uint64_t flushSeen;
+        bool closing;
+        {
+            std::unique_lock<std::mutex> locker(condMtx_);
+            if (!wakeup_ && !isClose_ && flushRequested_ == flushDone_) {
+                writerCond_.wait_for(locker, std::chrono::milliseconds(flushIntervalMs_.load()));
+            }
+            wakeup_ = false;
+            flushSeen = flushRequested_;
+            closing = isClose_;
+        }
+        segs.clear();
+        taken.clear();
+        DrainRings(segs, taken);
+        if (!segs.empty()) {
+            // 有二进制记录时先同步时钟，再把 TSC 换算成时间
+            bool records = false;
+            for (const struct iovec& seg : segs) {
+                if (memchr(seg.iov_base, LogRecord::MARK_RECORD, seg.iov_len)) {
+                    records = true;
+                    break;
+                }
+            }
+            if (records) {
+                if (!clock_.Calibrated()) { clock_.Calibrate(); }
+                clock_.Sync();
+            }
+            const struct tm& t = LogTime::Local(time(nullptr));
+            std::lock_guard<std::mutex> locker(mtx_);
+            if (isBinary_ || records) {
+                batch.clear();
+                for (const struct iovec& seg : segs) {
+                    batch.append(static_cast<const char*>(seg.iov_base), seg.iov_len);
+                }
+                if (isBinary_) {
+                    WriteBinary(batch, t);
+                }
+                else {
+                    text.clear();
+                    Expand(batch, text);
+                    struct iovec iov = {text.data(), text.size()};
+                    WriteToFile(&iov, 1, t);
+                }
+            }
+            else {
+                WriteToFile(segs.data(), segs.size(), t);
+            }
+            SyncIfDue();
+        }
+        // 写完才释放环中的空间
+        for (auto& ring : taken) {
+            ring.first->consume(ring.second);
+        }
+        spaceCond_.notify_all();
+        if (dropped_.load(std::memory_order_relaxed) != droppedReported_ ||
+                sampled_.load(std::memory_order_relaxed) != sampledReported_) {
+            std::lock_guard<std::mutex> locker(mtx_);
+            WriteSummary(closing);
+        }
+        {
+            std::lock_guard<std::mutex> locker(condMtx_);
+            flushDone_ = flushSeen;
+        }
+        flushCond_.notify_all();
+        if (closing) {
+            break;
+        }
     }
 }
 
@@ -194,4 +640,4 @@ Log& Log::Instance() {
 
 void Log::FlushLogThread() {
     Log::Instance().AsyncWrite();
-}
\ No newline at end of file
+}
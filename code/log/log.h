@@ -3,80 +3,199 @@
 #include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <condition_variable>
 #include <sys/time.h>
 #include <string.h>
 #include <stdarg.h>           // vastart va_end
 #include <assert.h>
 #include <sys/stat.h>         //mkdir
-#include "blockqueue.h"
-#include "../buffer/buffer.h"
+#include <sys/uio.h>          //writev
+#include <chrono>
+#include "logring.h"
+#include "logrecord.h"
 
 /*
+异步模式：
 ┌──────────────┐         ┌──────────────┐         ┌──────────────┐
-│  业务线程     │  push   │  BlockDeque  │  pop    │  写日志线程   │  write   │  文件
-│ (生产者)      │ ──────> │  (缓冲区)    │ ──────> │ (消费者)      │ ──────> │
+│  业务线程     │  push   │ 每线程 LogRing │  writev  │  写日志线程   │  writev  │  文件
+│ (生产者)      │ ──────> │  (无锁环形)    │ ──────> │ (消费者)      │ ──────> │
 └──────────────┘         └──────────────┘         └──────────────┘
+业务线程在自己的栈上格式化，整行放进本线程的环，不加锁；
+写日志线程定时(或某个环过半时被唤醒)把所有环中的数据直接作为 iovec 交给一次 writev，
+写完再释放环中的空间；换文件(按天或 MAX_LINES)也只在写日志线程里做，业务线程不等待。
+当前文件写到 3/4 时提前打开下一个文件并 fallocate 预留空间。
+同步模式：业务线程格式化后加锁直接 write。
+
+环写满(磁盘慢或日志突发)时的处理见 OVERFLOW_POLICY；丢弃与抽样的行数由写日志线程
+每 SUMMARY_INTERVAL_MS 汇总成一行 [warn] 写进日志。
+
+延迟格式化(DEFERRED/BINARY，仅异步模式)：调用点第一次执行时注册格式串，之后只把
+格式串地址、TSC 计数和原始参数拷进环(见 logrecord.h)，不调用 vsnprintf。
+DEFERRED 由写日志线程格式化成与文本模式相同的行；BINARY 直接写二进制文件，用 log_decoder 还原。
 */
 
 class Log {
 private:
     Log();
     virtual ~Log();
-    
-    void AppendLogLevelTitle(int level);
+
     void AsyncWrite();
 
 public:
+    enum FORMAT_MODE {
+        TEXT = 0,   // 业务线程格式化
+        DEFERRED,   // 写日志线程格式化，输出文本文件
+        BINARY,     // 不格式化，输出二进制文件
+    };
+
+    // 异步模式下本线程的环放不下(或接近放不下)时怎么办
+    enum OVERFLOW_POLICY {
+        BLOCK = 0,      // 等写日志线程腾出空间，不丢日志
+        DROP_NEWEST,    // 丢弃放不下的这一行
+        DROP_BY_LEVEL,  // 环超过 3/4 时丢弃 debug/info，warn/error 照常写入，满了也等待
+        SAMPLE,         // 环超过一半时每 N 行只保留 1 行，满了丢弃
+    };
+
     void init(int level, const char* path = "./log",
-                const char* suffix = ".log", 
-                int maxQueueCapacity = 1024);
+                const char* suffix = ".log",
+                int maxQueueCapacity = 1024,
+                FORMAT_MODE format = TEXT);
 
     static Log& Instance();
     static void FlushLogThread();
 
     void write(int level, const char* format, ...);
+
+    // 延迟格式化：fmt 由 RegisterFormat 得到，参数原样记录
+    template<typename... Args>
+    void writeDeferred(const LogFormat* fmt, Args... args) {
+        char record[LINE_SIZE];
+        LogArgWriter writer(fmt, LogClock::Now(), record, sizeof(record));
+        (writer.Put(args), ...);
+        Push(fmt->level, record, writer.Finish());
+    }
+    // 每个调用点注册一次，返回的指针一直有效
+    const LogFormat* RegisterFormat(int level, const char* format);
+    // 把已提交的日志全部写入文件后返回
     void flush();
 
-    int GetLevel();
-    void SetLevel(int level);
-    bool IsOpen() {return isOpen_;}
+    // 写日志线程最长隔 flushIntervalMs 把环中的日志写入文件；
+    // fsyncIntervalMs > 0 时至少隔这么久 fdatasync 一次，0 表示只写到内核，落盘交给内核
+    void SetFlushInterval(int flushIntervalMs, int fsyncIntervalMs = 0);
+
+    // sampleN 只对 SAMPLE 有效
+    void SetOverflowPolicy(OVERFLOW_POLICY policy, int sampleN = 10);
+    // 启动以来因环满丢弃 / 抽样略过的行数
+    uint64_t DroppedLines() { return dropped_.load(std::memory_order_relaxed); }
+    uint64_t SampledLines() { return sampled_.load(std::memory_order_relaxed); }
+
+    int GetLevel() { return level_.load(std::memory_order_relaxed); }
+    void SetLevel(int level) { level_.store(level, std::memory_order_relaxed); }
+    bool IsOpen() { return isOpen_.load(std::memory_order_relaxed); }
+    bool IsDeferred() { return isDeferred_.load(std::memory_order_relaxed); }
+
+    static constexpr size_t LINE_SIZE = 4096;      // 单行上限，超出截断
+    static constexpr int FLUSH_INTERVAL_MS = 100;   // 写日志线程默认的收集间隔
+    static constexpr int SUMMARY_INTERVAL_MS = 10000;   // 丢弃/抽样汇总行的最短间隔
 
 private:
     static const int LOG_PATH_LEN = 256;
     static const int LOG_NAME_LEN = 256;
     static const int MAX_LINES = 50000;
 
+    LogRing* LocalRing();
+    void Push(int level, const char* data, size_t len);
+    bool Admit(LogRing* ring, int level, int policy);
+    void WakeWriter();
+    void DrainRings(std::vector<struct iovec>& segs, std::vector<std::pair<LogRing*, size_t>>& taken);
+    void Expand(const std::string& batch, std::string& text);
+
+    // 以下由持有 mtx_ 的线程调用
+    void FileName(char* name, const struct tm& t, int index);
+    int OpenFile(const char* name);
+    void CloseFile(int fd);
+    void PrepareNext(const struct tm& t);
+    void DiscardNext();
+    void Rotate(const struct tm& t);
+    void WriteAll(struct iovec* iov, size_t cnt);
+    void WriteToFile(struct iovec* iov, size_t cnt, const struct tm& t);
+    void WriteBinary(const std::string& batch, const struct tm& t);
+    void SyncIfDue();
+    void WriteSummary(bool force);
+
     const char* path_;
     const char* suffix_;
 
     int MAX_LINES_;
 
-    int lineCount_; // 当前文件行数
+    int lineCount_; // 当日行数，由持有 mtx_ 的线程维护
+    int fileLines_; // 当前文件的行数
     int toDay_; // 当前天数
 
-    bool isOpen_;
-
-    Buffer buff_;   // 用于格式化日志内容的缓冲区
-    int level_;
-    bool isAsync_;  // 是否异步模式
-
-    FILE* fp_;  // 指向当前的 .log 文件
+    std::atomic<bool> isOpen_;
+    std::atomic<int> level_;
+    std::atomic<bool> isAsync_;  // 是否异步模式
+    std::atomic<bool> isDeferred_;  // 调用点是否走 writeDeferred
+    bool isBinary_;     // 当前文件是二进制格式，由持有 mtx_ 的线程读写
+    bool fileStarted_;  // 二进制文件已写入文件头
+    std::vector<bool> fileFormats_; // 按格式 id：已写入当前二进制文件
+    size_t ringSize_;   // 新建 LogRing 的容量
+
+    int fd_;    // 当前的日志文件
+    size_t fileBytes_;  // 本进程写入当前文件的字节数，用来估计下一个文件的大小
+    int nextFd_;        // 提前打开并预留了空间的下一个文件，-1 表示没有
+    std::string nextName_;
+    std::vector<struct iovec> iov_; // WriteToFile 按行切分后的 iovec，复用容量
+    std::atomic<int> flushIntervalMs_;
+    std::atomic<int> fsyncIntervalMs_;
+    std::chrono::steady_clock::time_point lastSync_;
+
+    std::atomic<int> overflow_;     // OVERFLOW_POLICY
+    std::atomic<int> sampleN_;
+    std::atomic<uint64_t> dropped_;
+    std::atomic<uint64_t> sampled_;
+    uint64_t droppedReported_;  // 以下只由写日志线程使用：上次汇总时的计数
+    uint64_t sampledReported_;
+    std::chrono::steady_clock::time_point lastSummary_;
+
+    std::mutex ringMtx_;    // 保护 rings_，只在线程第一次写日志和写日志线程收集时加锁
+    std::vector<std::shared_ptr<LogRing>> rings_;
+
+    std::mutex condMtx_;
+    std::condition_variable writerCond_;    // 唤醒写日志线程
+    std::condition_variable spaceCond_;     // 环满的生产者等待写日志线程腾出空间
+    std::condition_variable flushCond_;     // flush() 等待写日志线程写完
+    std::atomic<bool> wakeup_;
+    uint64_t flushRequested_;
+    uint64_t flushDone_;
+    bool isClose_;
+
+    std::mutex formatMtx_;  // 保护 formats_，只在调用点第一次执行时加锁
+    std::vector<std::unique_ptr<LogFormat>> formats_;
+    LogClock clock_;    // 只由写日志线程使用
 
-    std::unique_ptr<BlockDeque<std::string>> deque_;
     std::unique_ptr<std::thread> writeThread_;  // 后台写线程
-    std::mutex mtx_;
+    std::mutex mtx_;    // 保护 fd_ 与行数、文件轮转
 };
 
 #define LOG_BASE(level, format, ...) \
     do {\
         Log& log = Log::Instance();\
         if (log.IsOpen() && log.GetLevel() <= level) {\
-            log.write(level, format, ##__VA_ARGS__); \
-            log.flush();\
+            if (log.IsDeferred()) {\
+                static const LogFormat* logCallSite = log.RegisterFormat(level, format);\
+                log.writeDeferred(logCallSite, ##__VA_ARGS__);\
+            }\
+            else {\
+                log.write(level, format, ##__VA_ARGS__); \
+            }\
         }\
     } while(0);
 
 #define LOG_DEBUG(format, ...) do {LOG_BASE(0, format, ##__VA_ARGS__)} while(0);
 #define LOG_INFO(format, ...) do {LOG_BASE(1, format, ##__VA_ARGS__)} while(0);
 #define LOG_WARN(format, ...) do {LOG_BASE(2, format, ##__VA_ARGS__)} while(0);
-#define LOG_ERROR(format, ...) do {LOG_BASE(3, format, ##__VA_ARGS__)} while(0);
\ No newline at end of file
+#define LOG_ERROR(format, ...) do {LOG_BASE(3, format, ##__VA_ARGS__)} while(0);
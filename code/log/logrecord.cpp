@@ -0,0 +1,298 @@
+#include "logrecord.h"
+#include <cstdio>
+#include <cctype>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+static const char* const LEVEL_TITLE[] = {
+    "[debug]: ", "[info] : ", "[warn] : ", "[error]: ",
+};
+
+const char* LogRecord::LevelTitle(int level) {
+    return LEVEL_TITLE[level >= 0 && level <= 3 ? level : 1];
+}
+
+/* 跳过标志、宽度、精度和长度修饰，p 停在转换字符上；star 记录宽度/精度中 '*' 的个数 */
+static const char* SkipSpec(const char* p, int* stars, int* precision, bool* starPrecision) {
+    *stars = 0;
+    *precision = -1;
+    *starPrecision = false;
+    while (*p && strchr("-+ #0'", *p)) { p++; }
+    if (*p == '*') { (*stars)++; p++; }
+    while (isdigit(static_cast<unsigned char>(*p))) { p++; }
+    if (*p == '.') {
+        p++;
+        if (*p == '*') {
+            (*stars)++;
+            *starPrecision = true;
+            p++;
+        }
+        else {
+            *precision = 0;
+            while (isdigit(static_cast<unsigned char>(*p))) {
+                *precision = *precision * 10 + (*p - '0');
+                p++;
+            }
+        }
+    }
+    while (*p && strchr("hlLqjzt", *p)) { p++; }
+    return p;
+}
+
+void LogRecord::ParseLimits(const char* format, std::vector<int>& limits) {
+    limits.clear();
+    for (const char* p = format; (p = strchr(p, '%')) != nullptr; ) {
+        p++;
+        if (*p == '%') {
+            p++;
+            continue;
+        }
+        int stars, precision;
+        bool starPrecision;
+        p = SkipSpec(p, &stars, &precision, &starPrecision);
+        if (*p == '\0') { break; }
+        limits.insert(limits.end(), stars, -1);
+        limits.push_back(*p != 's' ? -1 : (starPrecision ? -2 : precision));
+        p++;
+    }
+}
+
+void LogRecord::AppendPrefix(int64_t usec, int level, std::string& out) {
+    char time[LogTime::LENGTH];
+    LogTime::Format(static_cast<time_t>(usec / 1000000), static_cast<long>(usec % 1000000), time);
+    out.append(time, sizeof(time));
+    out.append(LevelTitle(level));
+}
+
+thread_local LogTime::Cache LogTime::cache_;
+
+void LogTime::Refresh_(Cache& cache, time_t sec) {
+    localtime_r(&sec, &cache.tm);
+    char text[64];
+    snprintf(text, sizeof(text), "%04d-%02d-%02d %02d:%02d:%02d.",
+            cache.tm.tm_year + 1900, cache.tm.tm_mon + 1, cache.tm.tm_mday,
+            cache.tm.tm_hour, cache.tm.tm_min, cache.tm.tm_sec);
+    memcpy(cache.text, text, sizeof(cache.text));
+    cache.sec = sec;
+}
+
+// 顺序读取记录中的参数
+struct ArgReader {
+    const char* p;
+    const char* end;
+
+    bool Next(uint8_t* tag, uint64_t* bits, const char** str) {
+        if (p >= end) { return false; }
+        *tag = static_cast<uint8_t>(*p);
+        if (*tag == LogRecord::ARG_STR) {
+            if (end - p < 5) { return false; }
+            uint32_t n = LogRecord::Load<uint32_t>(p + 1);
+            if (static_cast<size_t>(end - p) < 5 + n + 1) { return false; }
+            *str = p + 5;
+            *bits = n;
+            p += 5 + n + 1;
+            return true;
+        }
+        if (end - p < 9) { return false; }
+        *bits = LogRecord::Load<uint64_t>(p + 1);
+        p += 9;
+        return true;
+    }
+
+    // '*' 宽度/精度取整数参数
+    bool NextInt(long long* v) {
+        uint8_t tag;
+        uint64_t bits;
+        const char* str;
+        if (!Next(&tag, &bits, &str)) { return false; }
+        *v = tag == LogRecord::ARG_DOUBLE ? static_cast<long long>(LogRecord::Load<double>(reinterpret_cast<const char*>(&bits)))
+                : static_cast<long long>(bits);
+        return true;
+    }
+};
+
+/*
+逐个转换说明还原：去掉长度修饰，按转换字符换成与记录中参数宽度一致的修饰(整数统一 ll)，
+'*' 代入对应的整数，再交给 snprintf 处理标志、宽度和精度，输出与直接 printf 一致
+*/
+void LogRecord::AppendMessage(const char* format, const char* args, size_t len, std::string& out) {
+    ArgReader reader = {args, args + len};
+    const char* p = format;
+    char piece[4096];
+    while (*p) {
+        const char* pct = strchr(p, '%');
+        if (pct == nullptr) {
+            out.append(p);
+            break;
+        }
+        out.append(p, pct - p);
+        p = pct + 1;
+        if (*p == '%') {
+            out.push_back('%');
+            p++;
+            continue;
+        }
+        // 重建转换说明：标志 + 宽度 + 精度 + 新的长度修饰 + 转换字符
+        char spec[64];
+        size_t n = 0;
+        spec[n++] = '%';
+        bool ok = true;
+        while (*p && strchr("-+ #0'", *p) && n < 16) { spec[n++] = *p++; }
+        for (int part = 0; part < 2 && ok; part++) {
+            if (part == 1) {
+                if (*p != '.') { break; }
+                spec[n++] = *p++;
+            }
+            if (*p == '*') {
+                long long v;
+                ok = reader.NextInt(&v);
+                if (ok) { n += snprintf(spec + n, sizeof(spec) - n, "%d", static_cast<int>(v)); }
+                p++;
+            }
+            else {
+                while (isdigit(static_cast<unsigned char>(*p)) && n < 40) { spec[n++] = *p++; }
+            }
+        }
+        while (*p && strchr("hlLqjzt", *p)) { p++; }
+        char conv = *p;
+        if (conv == '\0') { break; }
+        p++;
+
+        uint8_t tag = 0;
+        uint64_t bits = 0;
+        const char* str = nullptr;
+        if (ok) { ok = reader.Next(&tag, &bits, &str); }
+        if (!ok) {
+            out.append(pct, p - pct);   // 参数缺失(记录被截断)，原样输出
+            continue;
+        }
+        double d = LogRecord::Load<double>(reinterpret_cast<const char*>(&bits));
+        long long ll = tag == ARG_DOUBLE ? static_cast<long long>(d) : static_cast<long long>(bits);
+        int m = 0;
+        switch (conv) {
+            case 'd': case 'i':
+                memcpy(spec + n, "ll", 2);
+                spec[n + 2] = conv;
+                spec[n + 3] = '\0';
+                m = snprintf(piece, sizeof(piece), spec, ll);
+                break;
+            case 'u': case 'o': case 'x': case 'X':
+                memcpy(spec + n, "ll", 2);
+                spec[n + 2] = conv;
+                spec[n + 3] = '\0';
+                m = snprintf(piece, sizeof(piece), spec, static_cast<unsigned long long>(ll));
+                break;
+            case 'c':
+                spec[n] = conv;
+                spec[n + 1] = '\0';
+                m = snprintf(piece, sizeof(piece), spec, static_cast<int>(ll));
+                break;
+            case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+                spec[n] = conv;
+                spec[n + 1] = '\0';
+                m = snprintf(piece, sizeof(piece), spec, tag == ARG_DOUBLE ? d : static_cast<double>(ll));
+                break;
+            case 's':
+                if (tag != ARG_STR) { str = "(?)"; }
+                if (n == 1) {
+                    out.append(str);    // 最常见的 %s，不经过 snprintf
+                    continue;
+                }
+                spec[n] = conv;
+                spec[n + 1] = '\0';
+                m = snprintf(piece, sizeof(piece), spec, str);
+                break;
+            case 'p':
+                spec[n] = conv;
+                spec[n + 1] = '\0';
+                m = snprintf(piece, sizeof(piece), spec, reinterpret_cast<void*>(bits));
+                break;
+            default:
+                out.append(pct, p - pct);
+                continue;
+        }
+        if (m > 0) { out.append(piece, std::min<size_t>(m, sizeof(piece) - 1)); }
+    }
+}
+
+bool LogRecord::Decode(const char* data, size_t len, std::string& out) {
+    const size_t magicLen = sizeof(FILE_MAGIC) - 1;
+    if (len == 0 || static_cast<uint8_t>(data[0]) != MARK_START) { return false; }
+    std::vector<std::pair<int, std::string>> formats;  // 按 id：级别、格式串
+    const char* p = data;
+    const char* end = data + len;
+    while (p < end) {
+        size_t left = end - p;
+        switch (static_cast<uint8_t>(*p)) {
+            case MARK_START:
+                if (left < 1 + magicLen || memcmp(p + 1, FILE_MAGIC, magicLen) != 0) { return false; }
+                formats.clear();
+                p += 1 + magicLen;
+                break;
+            case MARK_FORMAT: {
+                if (left < 10) { return false; }
+                uint32_t id = Load<uint32_t>(p + 1);
+                int level = static_cast<uint8_t>(p[5]);
+                uint32_t n = Load<uint32_t>(p + 6);
+                if (left < 10 + n) { return false; }
+                if (formats.size() <= id) { formats.resize(id + 1); }
+                formats[id] = {level, std::string(p + 10, n)};
+                p += 10 + n;
+                break;
+            }
+            case MARK_RECORD: {
+                if (left < FILE_HEADER) { return false; }
+                uint32_t size = Load<uint32_t>(p + 1);
+                uint32_t id = Load<uint32_t>(p + 5);
+                int64_t usec = Load<int64_t>(p + 9);
+                if (size < FILE_HEADER || left < size || id >= formats.size()) { return false; }
+                AppendPrefix(usec, formats[id].first, out);
+                AppendMessage(formats[id].second.c_str(), p + FILE_HEADER, size - FILE_HEADER, out);
+                out.push_back('\n');
+                p += size;
+                break;
+            }
+            case MARK_TEXT: {
+                if (left < 5) { return false; }
+                uint32_t n = Load<uint32_t>(p + 1);
+                if (left < 5 + n) { return false; }
+                out.append(p + 5, n);
+                p += 5 + n;
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+LogClock::Sample LogClock::Sample_() {
+    // TSC 读两次取中点，与 clock_gettime 对齐
+    uint64_t t0 = Now();
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    uint64_t t1 = Now();
+    return {t0 + (t1 - t0) / 2, static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec};
+}
+
+void LogClock::Calibrate() {
+    anchor_ = Sample_();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    base_ = Sample_();
+    nsPerTick_ = static_cast<double>(base_.ns - anchor_.ns) / static_cast<double>(base_.tick - anchor_.tick);
+}
+
+void LogClock::Sync() {
+    base_ = Sample_();
+    if (base_.ns - anchor_.ns >= 1000000000 && base_.tick > anchor_.tick) {
+        nsPerTick_ = static_cast<double>(base_.ns - anchor_.ns) / static_cast<double>(base_.tick - anchor_.tick);
+        anchor_ = base_;
+    }
+}
+
+int64_t LogClock::ToMicros(uint64_t tick) const {
+    double delta = static_cast<double>(static_cast<int64_t>(tick - base_.tick)) * nsPerTick_;
+    return (base_.ns + static_cast<int64_t>(delta)) / 1000;
+}
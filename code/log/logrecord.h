@@ -0,0 +1,240 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <type_traits>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>  // __rdtsc
+#endif
+
+/*
+延迟格式化(二进制)日志的记录格式：调用点只记下格式串(每个调用点注册一次)、时间计数和原始参数，
+格式化交给写日志线程，或者整条记录原样写入二进制文件，由 log_decoder 离线还原。
+
+环中的记录：   | 0x00 | size:u32 | LogFormat*:8 | tick:u64 | 参数... |
+文件中的记录： | 0x00 | size:u32 | id:u32       | usec:i64 | 参数... |
+参数：         | tag:u8 | 值 |，整数/浮点/指针 8 字节，字符串为 len:u32 + 字节 + '\0'
+二进制文件中另有：
+    文件开始   | 0x02 | "WSLOG1\n" |，之后出现的格式 id 重新编号(每个进程从 0 开始)
+    格式串     | 0x01 | id:u32 | level:u8 | len:u32 | 格式串 |，某个 id 在文件中第一次出现前写一次
+    文本行     | 0x03 | len:u32 | 整行 |，未走延迟格式化的日志
+size 是整条记录的字节数；多字节字段按本机字节序，不要求对齐。
+文本日志行总以数字开头，环中的记录靠首字节 0x00 与之区分。
+*/
+
+// 一个 LOG_XXX 调用点的格式串，注册后常驻，调用点用静态变量缓存它的地址
+struct LogFormat {
+    uint32_t id;
+    int level;
+    const char* format;
+    std::vector<int> strLimit;  // 按参数下标：%s 读取的最大长度，-1 不限，-2 取前一个参数(%.*s)
+};
+
+class LogRecord {
+public:
+    enum MARK : uint8_t {
+        MARK_RECORD = 0x00,
+        MARK_FORMAT = 0x01,
+        MARK_START = 0x02,
+        MARK_TEXT = 0x03,
+    };
+    enum TAG : uint8_t {
+        ARG_INT = 1,
+        ARG_UINT,
+        ARG_DOUBLE,
+        ARG_STR,
+        ARG_PTR,
+    };
+
+    static constexpr size_t RING_HEADER = 1 + 4 + 8 + 8;
+    static constexpr size_t FILE_HEADER = 1 + 4 + 4 + 8;
+    static constexpr char FILE_MAGIC[] = "WSLOG1\n";
+
+    static const char* LevelTitle(int level);
+
+    // 按格式串算出每个 %s 参数的最大读取长度，注册格式串时调用一次
+    static void ParseLimits(const char* format, std::vector<int>& limits);
+
+    // "YYYY-MM-DD HH:MM:SS.uuuuuu [level]: "，与文本模式的行首一致
+    static void AppendPrefix(int64_t usec, int level, std::string& out);
+
+    // 按格式串把 [args, args + len) 中的参数还原成文本追加到 out，参数缺失时原样输出转换说明
+    static void AppendMessage(const char* format, const char* args, size_t len, std::string& out);
+
+    // 把整个二进制日志文件的内容还原成文本日志，格式不对时返回 false
+    static bool Decode(const char* data, size_t len, std::string& out);
+
+    template<typename T>
+    static void Store(char* dst, T v) { memcpy(dst, &v, sizeof(v)); }
+    template<typename T>
+    static T Load(const char* src) { T v; memcpy(&v, src, sizeof(v)); return v; }
+};
+
+/*
+日志行首的时间："YYYY-MM-DD HH:MM:SS.uuuuuu "。
+每个线程缓存当前这一秒的日期时间部分，同一秒内只改写 6 位微秒；跨秒才调用 localtime_r
+(它要拿 glibc 内部的锁、读时区状态)。
+*/
+class LogTime {
+public:
+    static constexpr size_t LENGTH = 27;
+
+    // 向 out 写入 LENGTH 个字符(不含 '\0')，返回该秒的本地时间，供换文件判断日期
+    static const struct tm& Format(time_t sec, long usec, char* out) {
+        Cache& cache = cache_;
+        if (sec != cache.sec) {
+            Refresh_(cache, sec);
+        }
+        memcpy(out, cache.text, 20);    // "YYYY-MM-DD HH:MM:SS."
+        for (int i = 25; i >= 20; i--) {
+            out[i] = static_cast<char>('0' + usec % 10);
+            usec /= 10;
+        }
+        out[26] = ' ';
+        return cache.tm;
+    }
+
+    // 只取本地时间，同样按秒缓存
+    static const struct tm& Local(time_t sec) {
+        Cache& cache = cache_;
+        if (sec != cache.sec) {
+            Refresh_(cache, sec);
+        }
+        return cache.tm;
+    }
+
+private:
+    struct Cache {
+        time_t sec = -1;
+        struct tm tm;
+        char text[21];
+    };
+    static void Refresh_(Cache& cache, time_t sec);
+    static thread_local Cache cache_;
+};
+
+/*
+在调用线程的栈上拼一条记录：只有拷贝，没有格式化。
+空间不够时后面的参数不再写入，还原时对应的转换说明原样输出。
+*/
+class LogArgWriter {
+public:
+    LogArgWriter(const LogFormat* fmt, uint64_t tick, char* buf, size_t size):
+            fmt_(fmt), buf_(buf), pos_(buf + LogRecord::RING_HEADER), end_(buf + size),
+            index_(0), lastInt_(-1), full_(false) {
+        buf_[0] = LogRecord::MARK_RECORD;
+        LogRecord::Store(buf_ + 5, fmt);
+        LogRecord::Store(buf_ + 13, tick);
+    }
+
+    template<typename T>
+    void Put(T v) {
+        if constexpr (std::is_integral_v<T> || std::is_enum_v<T>) {
+            if constexpr (std::is_signed_v<T> || std::is_enum_v<T>) {
+                lastInt_ = static_cast<int64_t>(v);
+                Put_(LogRecord::ARG_INT, static_cast<int64_t>(v));
+            }
+            else {
+                lastInt_ = static_cast<int64_t>(v);
+                Put_(LogRecord::ARG_UINT, static_cast<uint64_t>(v));
+            }
+        }
+        else if constexpr (std::is_floating_point_v<T>) {
+            Put_(LogRecord::ARG_DOUBLE, static_cast<double>(v));
+        }
+        else if constexpr (std::is_same_v<T, const char*> || std::is_same_v<T, char*>) {
+            PutStr_(v);
+        }
+        else if constexpr (std::is_pointer_v<T>) {
+            Put_(LogRecord::ARG_PTR, reinterpret_cast<uint64_t>(v));
+        }
+        else {
+            static_assert(sizeof(T) == 0, "unsupported log argument type");
+        }
+        index_++;
+    }
+
+    // 填好记录长度，返回整条记录的字节数
+    size_t Finish() {
+        uint32_t size = static_cast<uint32_t>(pos_ - buf_);
+        LogRecord::Store(buf_ + 1, size);
+        return size;
+    }
+
+private:
+    template<typename V>
+    void Put_(uint8_t tag, V v) {
+        if (full_ || static_cast<size_t>(end_ - pos_) < 1 + sizeof(v)) {
+            full_ = true;   // 空间不够，这个及之后的参数都不再写入
+            return;
+        }
+        *pos_ = tag;
+        LogRecord::Store(pos_ + 1, v);
+        pos_ += 1 + sizeof(v);
+    }
+
+    void PutStr_(const char* s) {
+        if (s == nullptr) { s = "(null)"; }
+        int limit = index_ < fmt_->strLimit.size() ? fmt_->strLimit[index_] : -1;
+        if (limit == -2) { limit = lastInt_ < 0 ? -1 : static_cast<int>(lastInt_); }
+        size_t room = end_ - pos_;
+        if (full_ || room < 1 + 4 + 1) {
+            full_ = true;
+            return;
+        }
+        size_t max = room - (1 + 4 + 1);
+        if (limit >= 0 && static_cast<size_t>(limit) < max) { max = limit; }
+        size_t n = strnlen(s, max);
+        *pos_ = LogRecord::ARG_STR;
+        LogRecord::Store(pos_ + 1, static_cast<uint32_t>(n));
+        memcpy(pos_ + 5, s, n);
+        pos_[5 + n] = '\0';
+        pos_ += 5 + n + 1;
+    }
+
+    const LogFormat* fmt_;
+    char* buf_;
+    char* pos_;
+    char* end_;
+    size_t index_;
+    int64_t lastInt_;
+    bool full_;
+};
+
+/*
+时间计数：x86 上直接读 TSC(不进内核、不走 vDSO 的换算)，其他平台退回 CLOCK_MONOTONIC 纳秒。
+换算成墙上时间只在写日志线程里做：启动时校准一次频率，之后每轮用最新的 (tick, 时间) 对做基准，
+每隔 1 秒以上重新估计一次频率。
+*/
+class LogClock {
+public:
+    static uint64_t Now() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#endif
+    }
+
+    void Calibrate();
+    void Sync();
+    bool Calibrated() const { return nsPerTick_ > 0; }
+    int64_t ToMicros(uint64_t tick) const;
+
+private:
+    struct Sample {
+        uint64_t tick;
+        int64_t ns;     // CLOCK_REALTIME
+    };
+    static Sample Sample_();
+
+    Sample anchor_ = {0, 0};    // 估计频率的起点
+    Sample base_ = {0, 0};      // 换算的基准
+    double nsPerTick_ = 0;
+};
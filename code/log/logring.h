@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <memory>
+#include <sys/uio.h>
+#include <assert.h>
+
+/*
+单生产者/单消费者的字节环形缓冲区，每个写日志的线程一个：
+生产者(业务线程)只写 head_，消费者(写日志线程)只写 tail_，双方都不加锁。
+一次 push 是一整条日志，消费者看到的可读数据总是以完整的记录结尾。
+
+head_/tail_ 单调递增，取模后才是下标；两者分在不同的 cache line，避免伪共享。
+*/
+class LogRing {
+public:
+    // capacity 必须是 2 的幂
+    explicit LogRing(size_t capacity): buf_(new char[capacity]), mask_(capacity - 1),
+            head_(0), tail_(0), closed_(false) {
+        assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+
+    // 生产者：空间不足时什么也不写，返回 false
+    bool push(const char* data, size_t len) {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        uint64_t tail = tail_.load(std::memory_order_acquire);
+        if (len > capacity() - (head - tail)) {
+            return false;
+        }
+        size_t off = head & mask_;
+        size_t first = std::min(len, capacity() - off);
+        memcpy(buf_.get() + off, data, first);
+        memcpy(buf_.get(), data + first, len - first);
+        head_.store(head + len, std::memory_order_release);
+        return true;
+    }
+
+    // 生产者视角的已用字节数，用于判断是否该唤醒消费者
+    size_t used() const {
+        return head_.load(std::memory_order_relaxed) - tail_.load(std::memory_order_relaxed);
+    }
+
+    // 消费者：可读数据最多分两段(绕回)，返回段数
+    int peek(struct iovec iov[2]) const {
+        uint64_t tail = tail_.load(std::memory_order_relaxed);
+        uint64_t head = head_.load(std::memory_order_acquire);
+        size_t len = head - tail;
+        if (len == 0) {
+            return 0;
+        }
+        size_t off = tail & mask_;
+        size_t first = std::min(len, capacity() - off);
+        iov[0].iov_base = buf_.get() + off;
+        iov[0].iov_len = first;
+        if (first == len) {
+            return 1;
+        }
+        iov[1].iov_base = buf_.get();
+        iov[1].iov_len = len - first;
+        return 2;
+    }
+
+    // 消费者：peek 到的数据处理完后释放空间
+    void consume(size_t len) {
+        tail_.store(tail_.load(std::memory_order_relaxed) + len, std::memory_order_release);
+    }
+
+    // 所属线程退出后置位，消费者写完剩余数据就丢弃该环
+    void close() { closed_.store(true, std::memory_order_release); }
+    bool closed() const { return closed_.load(std::memory_order_acquire); }
+
+private:
+    std::unique_ptr<char[]> buf_;
+    const size_t mask_;
+    alignas(64) std::atomic<uint64_t> head_;
+    alignas(64) std::atomic<uint64_t> tail_;
+    std::atomic<bool> closed_;
+};
@@ -1,10 +1,87 @@
 #include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
 #include "server/webserver.h"
 
-int main() {
+/*
+用法: ./server [-l loopNum] [-b epoll|uring] [-o] [-s bytes] [-c MB] [-H] [-L text|deferred|binary]
+              [-O block|newest|level|sample] [-n N] [-f ms] [-F ms]
+    -l  Reactor 数量，0(默认) 为单 Reactor + 线程池，
+        N > 0 为 N 个 one loop per thread 的 Reactor(SO_REUSEPORT)
+    -b  I/O 多路复用后端，默认 epoll；uring 在线程池模式下只做就绪通知，
+        与 -l N 同用时为完成模式(读写都以 SQE 提交，见 EventLoop)
+    -o  连接使用 EPOLLONESHOT 并在每次读写后重新注册(对比 epoll_ctl 开销用)
+    -s  不小于该字节数的文件用 sendfile 发送，默认 1048576，-1 全部走 mmap + writev
+    -c  小文件内容缓存的预算(MB)，默认 32，0 关闭
+    -H  读缓冲区的块按 2MB 大页分配
+    -L  日志格式化方式：text(默认)业务线程格式化；deferred 写日志线程格式化；
+        binary 写二进制 .blog 文件，用 log_decoder 还原
+    -O  日志环写满时的处理：block 等待不丢；newest 丢弃放不下的行；
+        level(默认) 丢弃 debug/info，warn/error 照常写入；sample 每 N 行保留 1 行
+    -n  sample 的 N，默认 10
+    -f  写日志线程最长隔多少毫秒把日志写入文件，默认 100
+    -F  至少隔多少毫秒 fdatasync 一次日志文件，默认 0 不主动落盘
+*/
+int main(int argc, char* argv[]) {
+    int loopNum = 0;
+    Poller::BACKEND backend = Poller::EPOLL;
+    bool oneShot = false;
+    long sendfileThreshold = 1024 * 1024;
+    long contentCacheBytes = 32 * 1024 * 1024;
+    bool hugePages = false;
+    Log::FORMAT_MODE logFormat = Log::TEXT;
+    Log::OVERFLOW_POLICY logOverflow = Log::DROP_BY_LEVEL;
+    int logSampleN = 10;
+    int logFlushMs = Log::FLUSH_INTERVAL_MS;
+    int logFsyncMs = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "l:b:os:c:HL:O:n:f:F:")) != -1) {
+        switch (opt) {
+            case 'l':
+                loopNum = atoi(optarg);
+                break;
+            case 'b':
+                backend = strcmp(optarg, "uring") == 0 ? Poller::IO_URING : Poller::EPOLL;
+                break;
+            case 'o':
+                oneShot = true;
+                break;
+            case 's':
+                sendfileThreshold = atol(optarg);
+                break;
+            case 'c':
+                contentCacheBytes = atol(optarg) * 1024 * 1024;
+                break;
+            case 'H':
+                hugePages = true;
+                break;
+            case 'L':
+                logFormat = strcmp(optarg, "binary") == 0 ? Log::BINARY :
+                        (strcmp(optarg, "deferred") == 0 ? Log::DEFERRED : Log::TEXT);
+                break;
+            case 'O':
+                if (strcmp(optarg, "block") == 0) { logOverflow = Log::BLOCK; }
+                else if (strcmp(optarg, "newest") == 0) { logOverflow = Log::DROP_NEWEST; }
+                else if (strcmp(optarg, "sample") == 0) { logOverflow = Log::SAMPLE; }
+                else { logOverflow = Log::DROP_BY_LEVEL; }
+                break;
+            case 'n':
+                logSampleN = atoi(optarg);
+                break;
+            case 'f':
+                logFlushMs = atoi(optarg);
+                break;
+            case 'F':
+                logFsyncMs = atoi(optarg);
+                break;
+            default:
+                return 1;
+        }
+    }
     WebServer server(8080, 3, 600000, false,         
         3306, "root", "326326", "WebServer",
-        12, 6, true, 0, 1024);
+        12, 6, true, 0, 1024, loopNum, backend, oneShot, sendfileThreshold, contentCacheBytes, hugePages, logFormat,
+        logOverflow, logSampleN, logFlushMs, logFsyncMs);
     server.start();
     return 0;
-}
\ No newline at end of file
+}
@@ -17,9 +17,14 @@ public:
             std::thread([pool = pool_]() {
                 std::unique_lock<std::mutex> locker(pool->mtx_);
                 while(true) {
-                    if (!pool->tasks.empty()) {
-                        auto task = std::move(pool->tasks.front());
-                        pool->tasks.pop();
+                    if (!pool->tasks.empty() || !pool->lowTasks.empty()) {
+                        // 普通任务优先；低优先级任务最多连续让出 LOW_SKIP_MAX 次，不会被饿死
+                        bool low = pool->tasks.empty() ||
+                                (!pool->lowTasks.empty() && pool->lowSkips >= LOW_SKIP_MAX);
+                        auto& queue = low ? pool->lowTasks : pool->tasks;
+                        auto task = std::move(queue.front());
+                        queue.pop();
+                        pool->lowSkips = (low || pool->lowTasks.empty()) ? 0 : pool->lowSkips + 1;
                         locker.unlock();
                         task();
                         locker.lock();
@@ -44,21 +49,27 @@ public:
         pool_->cv_.notify_all();
     }
     
+    // lowPriority: 进低优先级队列，普通任务优先；两队都有任务时每执行 LOW_SKIP_MAX 个普通任务
+    // 插入一个低优先级任务(约 8:1)，防止饿死。用于大文件传输等可以让路的任务
     template<class F>
-    void addTask(F&& task) {
+    void addTask(F&& task, bool lowPriority = false) {
         {
             std::lock_guard<std::mutex> locker(pool_->mtx_);
-            pool_->tasks.emplace(std::forward<F>(task));
+            (lowPriority ? pool_->lowTasks : pool_->tasks).emplace(std::forward<F>(task));
         }
         pool_->cv_.notify_one();
     }
 
+    static const int LOW_SKIP_MAX = 8;
+
 private:
     struct Pool {
         std::mutex mtx_;
         std::condition_variable cv_;
         bool isClosed;
         std::queue<std::function<void()>> tasks;
+        std::queue<std::function<void()>> lowTasks;
+        int lowSkips = 0;   // 低优先级队列非空时已连续执行的普通任务数
         int a;
     };
     std::shared_ptr<Pool> pool_;
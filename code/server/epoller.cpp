@@ -10,21 +10,25 @@ Epoller::~Epoller() {
     close(epollFd_);
 }
 
-bool Epoller::addFd(int fd, uint32_t events) {
+bool Epoller::addFd(int fd, uint32_t events, void* ptr) {
     //std::cout << "DEBUG: events = " << events << std::endl;
     if (fd < 0) return false;
     epoll_event ev = {0};
     ev.events = events;
-    ev.data.fd = fd;
+    if (ptr) ev.data.ptr = ptr;
+    else ev.data.fd = fd;
+    ctlCount_.fetch_add(1, std::memory_order_relaxed);
     int res = epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev);
     return res == 0 ? true : false;
 }
 
-bool Epoller::modFd(int fd, uint32_t events) {
+bool Epoller::modFd(int fd, uint32_t events, void* ptr) {
     if (fd < 0) return false;
     epoll_event ev = {0};
     ev.events = events;
-    ev.data.fd = fd;
+    if (ptr) ev.data.ptr = ptr;
+    else ev.data.fd = fd;
+    ctlCount_.fetch_add(1, std::memory_order_relaxed);
     int res = epoll_ctl(epollFd_, EPOLL_CTL_MOD, fd, &ev);
     return res == 0 ? true : false;
 }
@@ -32,11 +36,13 @@ bool Epoller::modFd(int fd, uint32_t events) {
 bool Epoller::delFd(int fd) {
     if (fd < 0) return false;
     epoll_event ev = {0};
+    ctlCount_.fetch_add(1, std::memory_order_relaxed);
     int res = epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, &ev);
     return res == 0 ? true : false;
 }
 
 int Epoller::wait(int timeoutMs) {
+    waitCount_++;
     return epoll_wait(epollFd_, &events_[0], 
                 static_cast<int>(events_.size()), timeoutMs);
 }
@@ -46,6 +52,11 @@ int Epoller::getEventFd(size_t idx) const {
     return events_[idx].data.fd;
 }
 
+void* Epoller::getEventPtr(size_t idx) const {
+    assert(idx < events_.size() && idx >= 0);
+    return events_[idx].data.ptr;
+}
+
 uint32_t Epoller::getEvents(size_t idx) const {
     assert(idx < events_.size() && idx >= 0);
     return events_[idx].events;
@@ -8,25 +8,32 @@
 #include <vector>
 #include <errno.h>
 
-class Epoller {
+#include "poller.h"
+
+class Epoller : public Poller {
 public:
     explicit Epoller(int maxEvent = 1024);
 
-    ~Epoller();
+    ~Epoller() override;
+
+    bool addFd(int fd, uint32_t events, void* ptr = nullptr) override;
+
+    bool modFd(int fd, uint32_t events, void* ptr = nullptr) override;
 
-    bool addFd(int fd, uint32_t events);
+    bool delFd(int fd) override;
 
-    bool modFd(int fd, uint32_t events);
+    int wait(int timeoutMs = -1) override;
 
-    bool delFd(int fd);
+    int getEventFd(size_t idx) const override;
 
-    int wait(int timeoutMs = -1);
+    void* getEventPtr(size_t idx) const override;
 
-    int getEventFd(size_t idx) const;
+    uint32_t getEvents(size_t idx) const override;
 
-    uint32_t getEvents(size_t idx) const;
+    uint64_t syscallCount() const override { return ctlCount() + waitCount_; }
 
 private:
     int epollFd_;
+    uint64_t waitCount_ = 0;    // 只在 loop 线程中 wait
     std::vector<struct epoll_event> events_;
 };
\ No newline at end of file
@@ -0,0 +1,573 @@
+#include "eventloop.h"
+
+/* 进程常驻内存，取自 /proc/self/statm 的第二列(页数) */
+static size_t residentBytes() {
+    FILE* fp = fopen("/proc/self/statm", "r");
+    if (!fp) { return 0; }
+    unsigned long size = 0, resident = 0;
+    int n = fscanf(fp, "%lu %lu", &size, &resident);
+    fclose(fp);
+    return n == 2 ? resident * sysconf(_SC_PAGESIZE) : 0;
+}
+
+static int64_t nowMs() {
+    return std::chrono::duration_cast<MS>(Clock::now().time_since_epoch()).count();
+}
+
+EventLoop::EventLoop(int port, uint32_t listenEvent, uint32_t connEvent,
+        int timeoutMs, bool optLinger, bool reusePort, ThreadPool* threadpool,
+        Poller::BACKEND backend):
+        port_(port), timeoutMs_(timeoutMs), openLinger_(optLinger),
+        reusePort_(reusePort), isClose_(false), listenFd_(-1),
+        listenEvent_(listenEvent), connEvent_(connEvent),
+        oneShot_(connEvent & EPOLLONESHOT), requests_(0), yields_(0), syscalls_(0),
+        lastRequests_(0), lastYields_(0), lastCtl_(0), lastSyscalls_(0),
+        nextStats_(Clock::now() + MS(STATS_INTERVAL_MS)),
+        threadpool_(threadpool), timer_(std::make_unique<HeapTimer>()), users_(MAX_FD) {
+    // io_uring + one loop per thread 走完成模式，在 init() 中建环
+    if (backend != Poller::IO_URING || threadpool_ || oneShot_) {
+        epoller_ = Poller::create(backend);
+    }
+}
+
+EventLoop::~EventLoop() {
+    isClose_ = true;
+    if (listenFd_ >= 0) {
+        close(listenFd_);
+    }
+    releaseUring_();
+}
+
+bool EventLoop::init() {
+    if (!epoller_ && !initUring_()) {
+        // 内核缺少所需特性(multishot、缓冲区环等)时退回就绪通知的 UringPoller
+        LOG_WARN("io_uring completion mode unavailable, fall back to poll mode!");
+        releaseUring_();
+        epoller_ = Poller::create(Poller::IO_URING);
+    }
+    return initSocket_();
+}
+
+/* 下一次 wait 的超时：最近的定时器(顺带处理已到期的)，且不睡过下一次统计时间 */
+int EventLoop::nextTimeout_() {
+    int timeMS = -1;    // epoll wait time,无事件将阻塞
+    if (timeoutMs_ > 0) {
+        timeMS = timer_->getNextTick();
+    }
+    // 到点输出统计
+    int toStats = std::chrono::duration_cast<MS>(nextStats_ - Clock::now()).count();
+    if (toStats <= 0) {
+        logStats_();
+        nextStats_ = Clock::now() + MS(STATS_INTERVAL_MS);
+        toStats = STATS_INTERVAL_MS;
+    }
+    if (timeMS < 0 || timeMS > toStats) {
+        timeMS = toStats;
+    }
+    return timeMS;
+}
+
+void EventLoop::loop() {
+    if (uring_) {
+        loopUring_();
+        return;
+    }
+    while(!isClose_) {
+        int timeMS = nextTimeout_();
+        // 有让出的连接时不阻塞；它们在本轮新事件处理完之后才继续写
+        size_t deferred = deferred_.size();
+        if (deferred > 0) {
+            timeMS = 0;
+        }
+        int eventCnt = epoller_->wait(timeMS);
+        for (int i = 0; i < eventCnt; i ++) {
+            void* ptr = epoller_->getEventPtr(i);
+            uint32_t events = epoller_->getEvents(i);
+            ConnSlot* slot = static_cast<ConnSlot*>(ptr);
+            if (ptr == &listenFd_) {
+                // 新连接事件(listen fd 以 &listenFd_ 作为 data.ptr 注册)
+                dealListen_();
+            }
+            else if (!oneShot_) {
+                dealEvents_(slot, events);
+            }
+            else if (events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                // 断连事件
+                dealDisconnect_(slot);
+            }
+            else if (events & EPOLLIN) {
+                // 输入事件
+                dealRead_(slot);
+            }
+            else if (events & EPOLLOUT) {
+                // 写出事件
+                dealWrite_(slot);
+            }
+            else {
+                // UB
+                LOG_ERROR("Unexpected event!");
+            }
+        }
+        if (deferred > 0) {
+            runDeferred_(deferred);
+        }
+    }
+}
+
+int EventLoop::setFdNonBlock(int fd) {
+    assert(fd > 0);
+    int oldOpt = fcntl(fd, F_GETFL);
+    assert(oldOpt >= 0);
+    return fcntl(fd, F_SETFL, oldOpt | O_NONBLOCK);
+}
+
+/* Create listen fd*/
+bool EventLoop::initSocket_() {
+    int ret;
+    struct sockaddr_in addr;
+
+    if(port_ > 65535 || port_ < 1024) {
+        LOG_ERROR("Port:%d error!",  port_);
+        return false;
+    }
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port_);   // htons和htonl不能用混！发生过bug！
+
+    struct linger optLinger = {0};
+    if (openLinger_) {
+        // 使用优雅关闭：直到所剩数据发完或超时
+        optLinger.l_onoff = 1;
+        optLinger.l_linger = 1;
+    }
+
+    listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
+    if(listenFd_ < 0) {
+        LOG_ERROR("Create socket error!", port_);
+        return false;
+    }
+
+    // 设置优雅关闭
+    ret = setsockopt(listenFd_, SOL_SOCKET, SO_LINGER,
+                 &optLinger, sizeof(optLinger));
+    if(ret < 0) {
+        close(listenFd_);
+        LOG_ERROR("Init linger error!", port_);
+        return false;
+    }
+
+    int optval = 1;
+    // 允许地址复用(允许绑定到处于 TIME_WAIT 状态的地址)
+    ret = setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR,
+    (const void*)&optval, sizeof(int));
+    if(ret == -1) {
+        LOG_ERROR("set socket setsockopt error !");
+        close(listenFd_);
+        return false;
+    }
+
+    // 多个 listen socket 绑定同一端口，内核按四元组哈希把新连接分给各个 loop
+    if (reusePort_) {
+        ret = setsockopt(listenFd_, SOL_SOCKET, SO_REUSEPORT,
+        (const void*)&optval, sizeof(int));
+        if(ret == -1) {
+            LOG_ERROR("set SO_REUSEPORT error !");
+            close(listenFd_);
+            return false;
+        }
+    }
+
+    ret = bind(listenFd_, (sockaddr*)&addr, sizeof(addr));
+    if(ret < 0) {
+        LOG_ERROR("Bind Port:%d error!", port_);
+        close(listenFd_);
+        return false;
+    }
+
+    ret = listen(listenFd_, 6); // TODO,n设置太小？
+    if(ret < 0) {
+        LOG_ERROR("Listen port:%d error!", port_);
+        close(listenFd_);
+        return false;
+    }
+    // 完成模式下由 loop 线程提交 multishot accept
+    if (epoller_) {
+        ret = epoller_->addFd(listenFd_, listenEvent_ | EPOLLIN, &listenFd_);
+        if(ret == 0) {
+            LOG_ERROR("Add listen fd error!");
+            close(listenFd_);
+            return false;
+        }
+    }
+    setFdNonBlock(listenFd_);
+    LOG_INFO("Server port:%d", port_);
+    return true;
+}
+
+void EventLoop::dealListen_() {
+    struct sockaddr_in clientAddr;
+    socklen_t addrLen = sizeof(clientAddr);
+    do {
+        int fd = accept(listenFd_, (sockaddr*)&clientAddr, &addrLen);
+        syscalls_.fetch_add(1, std::memory_order_relaxed);
+        if (fd < 0) return;
+        else if (HttpConn::userCount >= MAX_FD || fd >= MAX_FD) {
+            sendError_(fd, "Server is busy!");
+            LOG_WARN("Server is full!");
+            return;
+        }
+        addClient_(fd, clientAddr);
+    } while (listenEvent_ & EPOLLET);   // why
+}
+
+void EventLoop::dealDisconnect_(ConnSlot* slot) {
+    assert(slot && slot->conn);
+    HttpConn* client = slot->conn.get();
+    LOG_INFO("Client[%d] quit!", client->getFd());
+    slot->gen ++;
+    slot->state = CLOSED;
+    epoller_->delFd(client->getFd());
+    client->closeConn();
+}
+
+void EventLoop::dealRead_(ConnSlot* slot) {
+    assert(slot && slot->conn);
+    extendTime_(slot);
+    if (threadpool_) {
+        threadpool_->addTask(std::bind(&EventLoop::onRead_, this, slot, slot->gen.load()));
+    }
+    else {
+        onRead_(slot, slot->gen);
+    }
+}
+
+void EventLoop::dealWrite_(ConnSlot* slot) {
+    assert(slot && slot->conn);
+    extendTime_(slot);
+    if (threadpool_) {
+        threadpool_->addTask(std::bind(&EventLoop::onWrite_, this, slot, slot->gen.load()), isBulk_(slot));
+    }
+    else {
+        onWrite_(slot, slot->gen);
+    }
+}
+
+void EventLoop::onRead_(ConnSlot* slot, uint32_t gen) {
+    if (slot->gen != gen) return;   // 任务排队期间连接已关闭/fd 已复用
+    HttpConn* client = slot->conn.get();
+    int ret = -1;
+    int readErrno = 0;
+    ret = client->read(&readErrno);
+    if (ret <= 0 && readErrno != EAGAIN) {
+        dealDisconnect_(slot);
+        return;
+    }
+    onProcess(slot);
+
+}
+
+void EventLoop::onWrite_(ConnSlot* slot, uint32_t gen) {
+    if (slot->gen != gen) return;
+    HttpConn* client = slot->conn.get();
+    int ret = -1;
+    int writeErrno = 0;
+    ret = client->write(&writeErrno);
+    if (client->toWriteBytes() == 0) {
+        if (client->isKeepAlive()) {
+            onProcess(slot);
+            return;
+        }
+    }
+    else if (ret > 0) {
+        // 配额用完：ONESHOT 尚未重新注册，连接仍归本次处理，直接排到下一轮
+        yield_(slot);
+        return;
+    }
+    else if (ret < 0) {
+        if (writeErrno == EAGAIN) {
+            epoller_->modFd(client->getFd(), connEvent_ | EPOLLOUT, slot);
+            return;
+        }
+    }
+    dealDisconnect_(slot);
+}
+
+void EventLoop::onProcess(ConnSlot* slot) {
+    HttpConn* client = slot->conn.get();
+    if (int n = client->process()) {
+        requests_.fetch_add(n, std::memory_order_relaxed);
+        epoller_->modFd(client->getFd(), connEvent_ | EPOLLOUT, slot);
+    }
+    else {
+        epoller_->modFd(client->getFd(), connEvent_ | EPOLLIN, slot);
+    }
+}
+
+void EventLoop::onTimeout_(ConnSlot* slot, uint32_t gen) {
+    if (slot->gen != gen) return;   // 过期的定时器：连接早已关闭，fd 可能已被复用
+    if (uring_) {
+        // 发给慢速对端的一次 SEND 可能比超时还久，期间没有完成事件；对端仍在确认数据就重新计时
+        if (slot->sending && uringSendProgressed_(slot)) {
+            timer_->add(slot->fd, timeoutMs_, std::bind(&EventLoop::onTimeout_, this, slot, gen));
+            return;
+        }
+        uringClose_(slot);
+        return;
+    }
+    // 线程池中让出的传输一直在写，但没有新的 epoll 事件，按最近一次让出的时间重新计时
+    int64_t idle = nowMs() - slot->lastActive.load(std::memory_order_relaxed);
+    if (idle < timeoutMs_) {
+        timer_->add(slot->conn->getFd(), timeoutMs_ - idle,
+            std::bind(&EventLoop::onTimeout_, this, slot, gen));
+        return;
+    }
+    if (oneShot_) {
+        dealDisconnect_(slot);
+    }
+    else {
+        // 连接可能正被工作线程持有，关闭也要走所有权状态
+        dealEvents_(slot, EPOLLHUP);
+    }
+}
+
+void EventLoop::dealEvents_(ConnSlot* slot, uint32_t events) {
+    assert(slot && slot->conn);
+    uint32_t bits = 0;
+    if (events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) bits |= CLOSE;
+    if (events & EPOLLIN) bits |= READ;
+    if (events & EPOLLOUT) bits |= WRITE;
+    if (!threadpool_) {
+        // one loop per thread：本线程就是唯一所有者
+        if (slot->state & CLOSED) return;
+        if (!(bits & CLOSE)) extendTime_(slot);
+        if (handleEvents_(slot, bits) == YIELDED) {
+            yield_(slot);
+        }
+        return;
+    }
+    uint32_t prev = slot->state.fetch_or(bits | RUNNING);
+    if (prev & (RUNNING | CLOSED)) {
+        // 已有线程持有(事件已合并进 state，由其处理)或连接已关闭
+        return;
+    }
+    if (!(bits & CLOSE)) extendTime_(slot);
+    threadpool_->addTask(std::bind(&EventLoop::onEvents_, this, slot, slot->gen.load()), isBulk_(slot));
+}
+
+void EventLoop::onEvents_(ConnSlot* slot, uint32_t gen) {
+    if (slot->gen != gen) return;
+    // 取走待处理事件，保留 RUNNING；处理完若没有新事件到达则释放所有权
+    uint32_t bits = slot->state.fetch_and(RUNNING);
+    while (true) {
+        HANDLE_RESULT result = handleEvents_(slot, bits);
+        if (result == DISCONNECTED) {
+            return;
+        }
+        if (result == YIELDED) {
+            // 保持 RUNNING 重新排队：ET 下套接字仍可写，不会再有 EPOLLOUT，由 WRITE 位驱动下一轮
+            slot->state.fetch_or(WRITE);
+            yield_(slot);
+            return;
+        }
+        uint32_t expected = RUNNING;
+        if (slot->state.compare_exchange_strong(expected, 0)) {
+            return;
+        }
+        bits = slot->state.fetch_and(RUNNING);
+    }
+}
+
+/* 处理一轮事件 */
+EventLoop::HANDLE_RESULT EventLoop::handleEvents_(ConnSlot* slot, uint32_t bits) {
+    HttpConn* client = slot->conn.get();
+    if (bits & CLOSE) {
+        dealDisconnect_(slot);
+        return DISCONNECTED;
+    }
+    int saveErrno = 0;
+    if (bits & READ) {
+        ssize_t ret = client->read(&saveErrno);
+        if (ret <= 0 && saveErrno != EAGAIN) {
+            dealDisconnect_(slot);
+            return DISCONNECTED;
+        }
+    }
+    // 先写完积压的响应，再处理缓冲区里的下一个请求；ET 下 EAGAIN 后等待下一次 EPOLLOUT 边沿
+    while (true) {
+        if (client->toWriteBytes() > 0) {
+            saveErrno = 0;
+            ssize_t ret = client->write(&saveErrno);
+            if (client->toWriteBytes() > 0) {
+                if (ret > 0) {
+                    return YIELDED;
+                }
+                if (ret < 0 && saveErrno == EAGAIN) {
+                    return WAITING;
+                }
+                dealDisconnect_(slot);
+                return DISCONNECTED;
+            }
+            if (!client->isKeepAlive()) {
+                dealDisconnect_(slot);
+                return DISCONNECTED;
+            }
+        }
+        int n = client->process();
+        if (n == 0) {
+            return WAITING;
+        }
+        requests_.fetch_add(n, std::memory_order_relaxed);
+    }
+}
+
+/*
+连接用完了本轮的写配额，调用方仍持有该连接：
+线程池模式下排进低优先级队列，否则放入 deferred_ 等下一轮事件处理完
+*/
+void EventLoop::yield_(ConnSlot* slot) {
+    yields_.fetch_add(1, std::memory_order_relaxed);
+    slot->lastActive.store(nowMs(), std::memory_order_relaxed);
+    if (threadpool_) {
+        if (oneShot_) {
+            threadpool_->addTask(std::bind(&EventLoop::onWrite_, this, slot, slot->gen.load()), true);
+        }
+        else {
+            threadpool_->addTask(std::bind(&EventLoop::onEvents_, this, slot, slot->gen.load()), true);
+        }
+        return;
+    }
+    // 让出后又因读事件写满配额时不重复加入
+    if (!(slot->state.fetch_or(DEFERRED) & DEFERRED)) {
+        deferred_.emplace_back(slot, slot->gen.load());
+    }
+}
+
+/* 继续写 deferred_ 中前 count 个连接，每个连接一份配额；期间再次让出的排到下一轮 */
+void EventLoop::runDeferred_(size_t count) {
+    for (size_t i = 0; i < count; i ++) {
+        auto [slot, gen] = deferred_[i];
+        if (slot->gen != gen) continue;     // 等待期间连接已关闭
+        slot->state.fetch_and(~DEFERRED);
+        extendTime_(slot);
+        if (oneShot_) {
+            onWrite_(slot, gen);
+        }
+        else if (handleEvents_(slot, WRITE) == YIELDED) {
+            yield_(slot);
+        }
+    }
+    deferred_.erase(deferred_.begin(), deferred_.begin() + count);
+}
+
+/* 待写数据超过一份配额的连接(大文件传输)，其任务以低优先级排队；调用方须持有该连接 */
+bool EventLoop::isBulk_(ConnSlot* slot) const {
+    return slot->conn->toWriteBytes() > HttpConn::WRITE_QUANTUM;
+}
+
+/* 本 loop 进入内核的次数(FileCache 未命中时的 stat/open 不计) */
+uint64_t EventLoop::syscallCount_() const {
+    uint64_t n = syscalls_.load(std::memory_order_relaxed);
+    return n + (uring_ ? uring_->enterCount() : epoller_->syscallCount());
+}
+
+void EventLoop::logStats_() {
+    uint64_t requests = requests_.load(std::memory_order_relaxed);
+    uint64_t ctl = epoller_ ? epoller_->ctlCount() : 0;
+    uint64_t syscalls = syscallCount_();
+    uint64_t dReq = requests - lastRequests_;
+    uint64_t dCtl = ctl - lastCtl_;
+    uint64_t yields = yields_.load(std::memory_order_relaxed);
+    if (dReq > 0) {
+        LOG_INFO("Loop[%d] stats: requests:%llu, ctl:%llu, ctl/request:%.2f, syscalls/request:%.2f (%s), write yields:%llu",
+            listenFd_, (unsigned long long)dReq, (unsigned long long)dCtl, (double)dCtl / dReq,
+            (double)(syscalls - lastSyscalls_) / dReq,
+            uring_ ? "io_uring completion" : (oneShot_ ? "oneshot" : "no-rearm"),
+            (unsigned long long)(yields - lastYields_));
+    }
+    lastRequests_ = requests;
+    lastYields_ = yields;
+    lastCtl_ = ctl;
+    lastSyscalls_ = syscalls;
+
+    // 缓存是全局的，多个 loop 同一周期内只记一次
+    static std::atomic<int64_t> nextCacheStats(0);
+    int64_t now = nowMs();
+    int64_t next = nextCacheStats.load(std::memory_order_relaxed);
+    if (dReq == 0 || now < next ||
+            !nextCacheStats.compare_exchange_strong(next, now + STATS_INTERVAL_MS / 2)) {
+        return;
+    }
+    FileCache* files = FileCache::Instance();
+    ContentCache* contents = ContentCache::Instance();
+    Compressor* compressor = Compressor::Instance();
+    LOG_INFO("Cache stats: file hits:%llu, misses:%llu, loads:%llu; "
+        "content hits:%llu, misses:%llu, evictions:%llu, %zu objects, %zu bytes",
+        (unsigned long long)files->hits(), (unsigned long long)files->misses(),
+        (unsigned long long)files->loads(), (unsigned long long)contents->hits(),
+        (unsigned long long)contents->misses(), (unsigned long long)contents->evictions(),
+        contents->count(), contents->bytes());
+    BlockPool* blocks = BlockPool::Instance();
+    size_t totalBlocks = blocks->TotalBlocks(), freeBlocks = blocks->FreeBlocks();
+    LOG_INFO("Memory stats: rss:%zuKB, read buffer blocks: %zu in use, %zu idle, %zuKB total",
+        residentBytes() / 1024, totalBlocks - freeBlocks, freeBlocks,
+        totalBlocks * BlockPool::BLOCK_SIZE / 1024);
+    if (compressor->jobs() > 0) {
+        LOG_INFO("Gzip stats: jobs:%llu, %llu -> %llu bytes, cpu:%.2fms",
+            (unsigned long long)compressor->jobs(), (unsigned long long)compressor->bytesIn(),
+            (unsigned long long)compressor->bytesOut(), compressor->cpuNs() / 1e6);
+    }
+    uint64_t dropped = Log::Instance().DroppedLines(), sampled = Log::Instance().SampledLines();
+    if (dropped > 0 || sampled > 0) {
+        LOG_WARN("Log stats: dropped:%llu, sampled out:%llu",
+            (unsigned long long)dropped, (unsigned long long)sampled);
+    }
+}
+
+void EventLoop::addClient_(int fd, struct sockaddr_in clientAddr) {
+    assert(fd > 0 && fd < MAX_FD);
+    ConnSlot* slot = &users_[fd];
+    if (!slot->conn) {
+        slot->conn = std::make_unique<HttpConn>();
+        slot->conn->setSyscallCounter(&syscalls_);
+    }
+    uint32_t gen = ++ slot->gen;
+    slot->state = 0;
+    slot->lastActive = 0;
+    slot->conn->initConn(fd, clientAddr);
+    if (timeoutMs_ > 0) {
+        timer_->add(fd, timeoutMs_,
+            std::bind(&EventLoop::onTimeout_, this, slot, gen));
+    }
+    if (uring_) {
+        assert(slot->inflight == 0);
+        slot->fd = fd;
+        slot->recving = slot->sending = false;
+        slot->fileBuf = -1;
+        slot->fileOff = slot->fileLen = 0;
+        slot->acked = 0;
+        uringArmRecv_(slot, true);
+        LOG_INFO("Client[%d] in!", fd);
+        return;
+    }
+    // 非 ONESHOT 模型：读写事件一次注册，之后不再 modFd
+    epoller_->addFd(fd, connEvent_ | EPOLLIN | (oneShot_ ? 0u : static_cast<uint32_t>(EPOLLOUT)), slot);
+    setFdNonBlock(fd);
+    syscalls_.fetch_add(2, std::memory_order_relaxed);
+    LOG_INFO("Client[%d] in!", fd);
+}
+
+void EventLoop::sendError_(int fd, const char* message) {
+    assert(fd > 0);
+    int ret = send(fd, message, strlen(message), 0);
+    if(ret < 0) {
+        LOG_WARN("send error to client[%d] error!", fd);
+    }
+    close(fd);
+}
+
+void EventLoop::extendTime_(ConnSlot* slot) {
+    assert(slot);
+    if (timeoutMs_ > 0) {
+        timer_->adjust(slot->conn->getFd(), timeoutMs_);
+    }
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include "poller.h"
+#include "iouring.h"
+#include "../log/log.h"
+#include "../timer/heaptimer.h"
+#include "../pool/threadpool.h"
+#include "../http/httpconn.h"
+
+/*
+一个 EventLoop = 一个 Reactor：持有自己的 listen fd、Epoller、HeapTimer 和连接表。
+threadpool 非空：单 Reactor + 线程池，读写交给工作线程处理
+threadpool 为空：one loop per thread，连接的整个生命周期都在本线程内完成
+
+connEvent 带 EPOLLONESHOT：每次读写后 modFd 重新注册(旧模型)
+否则(要求 ET)：连接只在建立时以 EPOLLIN | EPOLLOUT 注册一次，不再 modFd；
+线程池模式下由 ConnSlot::state 保证同一时刻只有一个工作线程处理该连接
+
+写公平：HttpConn::write 每次最多写出 WRITE_QUANTUM 字节，配额用完的连接(大文件下载)让出线程：
+线程池模式下以低优先级任务重新排队，否则放入 deferred_，在下一轮 epoll 事件处理完之后才继续写，
+小文件请求的首字节时间不受并发大文件传输的影响
+
+io_uring 完成模式(threadpool 为空、后端为 io_uring 且不强制 ONESHOT)：不再等就绪事件，
+I/O 本身以 SQE 提交，每轮 wait 把积压的 SQE 与等待合并成一次 io_uring_enter：
+    multishot accept；连接 fd 填入固定文件表(IORING_OP_FILES_UPDATE)，之后都以 IOSQE_FIXED_FILE 引用
+    multishot recv，数据直接落进缓冲区环中的 BlockPool 块，整块交给读缓冲区
+    响应以 SENDMSG 发出；sendfile 的文件体用 READ_FIXED 分块读进固定缓冲区再 SEND
+    关闭时 ASYNC_CANCEL 掉挂着的操作，全部 CQE 回来后以 IORING_OP_CLOSE 关闭
+FileCache 未命中时的 stat/open 仍在本线程同步执行(命中时没有系统调用)。见 uringloop.cpp
+*/
+class EventLoop {
+public:
+    EventLoop(int port, uint32_t listenEvent, uint32_t connEvent,
+        int timeoutMs, bool optLinger, bool reusePort, ThreadPool* threadpool,
+        Poller::BACKEND backend = Poller::EPOLL);
+    ~EventLoop();
+
+    bool init();
+
+    void loop();
+
+    void quit() { isClose_ = true; }
+
+    static int setFdNonBlock(int fd);
+
+    static const int MAX_FD = 65536;
+
+private:
+    /*
+    连接槽，按 fd 下标预分配，epoll_event.data.ptr 直接指向槽位。
+    槽位地址在 loop 生命周期内不变；HttpConn 在该 fd 第一次使用时构造，之后复用。
+    gen 在连接建立与关闭时递增，定时器回调/线程池任务携带创建时的 gen，
+    不一致说明 fd 已被关闭或复用，直接丢弃。
+    */
+    struct alignas(64) ConnSlot {
+        std::unique_ptr<HttpConn> conn;
+        std::atomic<uint32_t> gen{0};
+        std::atomic<uint32_t> state{0};     // 非 ONESHOT 模型下的所有权状态，见 CONN_STATE
+        std::atomic<int64_t> lastActive{0}; // 让出时记录的时间(ms)，工作线程上的进展不经过 extendTime_
+
+        // io_uring 完成模式的在途操作，仅 loop 线程访问
+        int fd = -1;                // IORING_OP_FILES_UPDATE 从这里取 fd
+        uint16_t inflight = 0;      // 还会产生 CQE 的 SQE 数(multishot recv 算一个)，归零后才关闭 fd
+        bool recving = false;       // multishot recv 仍挂着
+        bool sending = false;       // 发送/文件读取在途或在等固定缓冲区，期间不解析新请求
+        int fileBuf = -1;           // 占用的固定缓冲区下标
+        uint32_t fileOff = 0;       // 固定缓冲区中 [fileOff, fileLen) 已读入、未发送
+        uint32_t fileLen = 0;
+        uint64_t acked = 0;         // 上次超时检查时对端已确认的字节数
+    };
+
+    /*
+    RUNNING: 已有工作线程持有该连接，期间到达的事件只置位，由持有者处理完当前事件后接着处理
+    CLOSED:  连接已关闭，不再派发任务，直到该槽位被新连接复用
+    */
+    enum CONN_STATE {
+        RUNNING = 1 << 0,
+        READ    = 1 << 1,
+        WRITE   = 1 << 2,
+        CLOSE   = 1 << 3,
+        CLOSED  = 1 << 4,
+        DEFERRED = 1 << 5,  // 已在 deferred_ 中等待下一轮
+    };
+
+    // handleEvents_ 的处理结果
+    enum HANDLE_RESULT {
+        DISCONNECTED,   // 连接已关闭
+        WAITING,        // 等待新的读写事件
+        YIELDED,        // 写配额用完，还有数据待写
+    };
+
+    bool initSocket_();
+    int nextTimeout_();
+
+    void dealListen_();
+    void dealDisconnect_(ConnSlot* slot);
+    void dealRead_(ConnSlot* slot);
+    void dealWrite_(ConnSlot* slot);
+
+    void onRead_(ConnSlot* slot, uint32_t gen);
+    void onWrite_(ConnSlot* slot, uint32_t gen);
+    void onProcess(ConnSlot* slot);
+    void onTimeout_(ConnSlot* slot, uint32_t gen);
+
+    void dealEvents_(ConnSlot* slot, uint32_t events);
+    void onEvents_(ConnSlot* slot, uint32_t gen);
+    HANDLE_RESULT handleEvents_(ConnSlot* slot, uint32_t bits);
+
+    void yield_(ConnSlot* slot);
+    void runDeferred_(size_t count);
+    bool isBulk_(ConnSlot* slot) const;
+
+    void logStats_();
+    uint64_t syscallCount_() const;
+
+    // io_uring 完成模式，实现在 uringloop.cpp
+    bool initUring_();
+    void releaseUring_();
+    void loopUring_();
+    void onCqe_(const struct io_uring_cqe& cqe);
+    void uringArmAccept_();
+    void uringArmRecv_(ConnSlot* slot, bool install);
+    void onUringAccept_(int res, uint32_t flags);
+    void onUringRecv_(ConnSlot* slot, int res, uint32_t flags);
+    void onUringSend_(ConnSlot* slot, int res);
+    void onUringFileRead_(ConnSlot* slot, int res);
+    void uringProcess_(ConnSlot* slot);
+    void uringSend_(ConnSlot* slot);
+    void uringClose_(ConnSlot* slot);
+    void uringFinishClose_(ConnSlot* slot);
+    bool uringSendProgressed_(ConnSlot* slot);
+    void releaseFileBuf_(ConnSlot* slot);
+    void serveFileBufWaiters_();
+
+    void addClient_(int fd, struct sockaddr_in clientAddr);
+
+    void sendError_(int fd, const char* message);
+
+    void extendTime_(ConnSlot* slot);
+
+    int port_;
+    int timeoutMs_;
+    bool openLinger_;   // socket优雅关闭
+    bool reusePort_;    // 多个 loop 各自 bind 同一端口，由内核分发连接
+    std::atomic<bool> isClose_;
+    int listenFd_;
+
+    uint32_t listenEvent_;  // listen fd对应的events
+    uint32_t connEvent_;
+    bool oneShot_;
+
+    // 统计：每个请求平均花费的 epoll_ctl 次数与系统调用次数
+    static constexpr int STATS_INTERVAL_MS = 10000;
+    std::atomic<uint64_t> requests_;
+    std::atomic<uint64_t> yields_;  // 写配额用完让出的次数
+    std::atomic<uint64_t> syscalls_;    // accept/fcntl/getpeername 与连接上的 read/write/close，不含 Poller
+    uint64_t lastRequests_;
+    uint64_t lastYields_;
+    uint64_t lastCtl_;
+    uint64_t lastSyscalls_;
+    TimeStamp nextStats_;
+
+    ThreadPool* threadpool_;    // 不持有，为空时在本线程处理读写
+    std::unique_ptr<HeapTimer> timer_;
+    std::unique_ptr<Poller> epoller_;   // 完成模式下为空
+    std::vector<ConnSlot> users_;    // [fd] -> 连接槽，大小 MAX_FD
+    std::vector<std::pair<ConnSlot*, uint32_t>> deferred_;  // 无线程池时让出的连接及其 gen，仅本线程访问
+
+    // io_uring 完成模式
+    static constexpr unsigned URING_ENTRIES = 1024;
+    static constexpr unsigned RECV_BUFS = 128;      // 缓冲区环中的块数，2 的幂
+    static constexpr uint16_t RECV_GROUP = 0;
+    static constexpr int FILE_BUFS = 16;
+    static constexpr size_t FILE_BUF_SIZE = 128 * 1024;
+    std::unique_ptr<IoUring> uring_;    // 为空时走 epoller_
+    unsigned fixedFiles_ = 0;           // 固定文件表大小，以 fd 为下标
+    std::vector<char*> recvBufs_;       // [bid] -> 缓冲区环中的块
+    char* fileBufBase_ = nullptr;       // FILE_BUFS 个固定缓冲区连续存放
+    bool fixedBufs_ = false;            // 固定缓冲区注册成功，用 READ_FIXED；否则退回普通 READ
+    std::vector<int> freeFileBufs_;
+    std::deque<std::pair<ConnSlot*, uint32_t>> fileBufWaiters_;     // 等固定缓冲区的连接及其 gen
+};
@@ -0,0 +1,227 @@
+#include "iouring.h"
+#include <algorithm>
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+IoUring::~IoUring() {
+    release_();
+}
+
+bool IoUring::init(unsigned entries, unsigned cqEntries, bool singleIssuer) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    if (cqEntries > 0) {
+        p.flags |= IORING_SETUP_CQSIZE;
+        p.cq_entries = cqEntries;
+    }
+    if (singleIssuer) {
+        // 创建环的线程与之后提交的 loop 线程不同，先禁用，enable() 时才绑定提交线程
+        struct io_uring_params q = p;
+        q.flags |= IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN | IORING_SETUP_R_DISABLED;
+        ringFd_ = syscall(__NR_io_uring_setup, entries, &q);
+        if (ringFd_ >= 0) {
+            p = q;
+            deferTaskrun_ = true;
+        }
+    }
+    if (ringFd_ < 0) {
+        ringFd_ = syscall(__NR_io_uring_setup, entries, &p);
+    }
+    // 需要 io_uring_enter 带超时等待
+    if (ringFd_ < 0 || !(p.features & IORING_FEAT_EXT_ARG) || !mapRings_(p)) {
+        release_();
+        return false;
+    }
+    features_ = p.features;
+    return true;
+}
+
+bool IoUring::mapRings_(const struct io_uring_params& p) {
+    sqRingSize_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cqRingSize_ = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+    }
+    sqRing_ = mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQ_RING);
+    if (sqRing_ == MAP_FAILED) {
+        sqRing_ = nullptr;
+        return false;
+    }
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        cqRing_ = sqRing_;
+    }
+    else {
+        cqRing_ = mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_CQ_RING);
+        if (cqRing_ == MAP_FAILED) {
+            cqRing_ = nullptr;
+            return false;
+        }
+    }
+    sqesSize_ = p.sq_entries * sizeof(struct io_uring_sqe);
+    void* sqes = mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        return false;
+    }
+    sqes_ = static_cast<struct io_uring_sqe*>(sqes);
+
+    char* sq = static_cast<char*>(sqRing_);
+    sqHead_ = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+    sqMask_ = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+    sqEntries_ = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_entries);
+    // SQE 下标与 array 槽位一一对应，之后只需推进 tail
+    unsigned* array = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+    for (unsigned i = 0; i < sqEntries_; i ++) {
+        array[i] = i;
+    }
+    sqeTail_ = *sqTail_;
+
+    char* cq = static_cast<char*>(cqRing_);
+    cqHead_ = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+    cqMask_ = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<struct io_uring_cqe*>(cq + p.cq_off.cqes);
+    return true;
+}
+
+void IoUring::release_() {
+    if (bufRing_) {
+        munmap(bufRing_, bufRingSize_);
+        bufRing_ = nullptr;
+    }
+    if (sqes_) {
+        munmap(sqes_, sqesSize_);
+        sqes_ = nullptr;
+    }
+    if (cqRing_ && cqRing_ != sqRing_) {
+        munmap(cqRing_, cqRingSize_);
+    }
+    cqRing_ = nullptr;
+    if (sqRing_) {
+        munmap(sqRing_, sqRingSize_);
+        sqRing_ = nullptr;
+    }
+    if (ringFd_ >= 0) {
+        close(ringFd_);
+        ringFd_ = -1;
+    }
+}
+
+bool IoUring::enable() {
+    return !deferTaskrun_ || register_(IORING_REGISTER_ENABLE_RINGS, nullptr, 0) == 0;
+}
+
+int IoUring::enter_(unsigned toSubmit, unsigned minComplete, unsigned flags,
+        const void* arg, size_t argSize) {
+    enterCount_.fetch_add(1, std::memory_order_relaxed);
+    return syscall(__NR_io_uring_enter, ringFd_, toSubmit, minComplete, flags, arg, argSize);
+}
+
+int IoUring::register_(unsigned opcode, const void* arg, unsigned nrArgs) {
+    return syscall(__NR_io_uring_register, ringFd_, opcode, arg, nrArgs);
+}
+
+unsigned IoUring::unsubmitted() const {
+    return sqeTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+}
+
+struct io_uring_sqe* IoUring::getSqe() {
+    // SQ 满：先把已填好的 SQE 提交掉腾出槽位
+    while (unsubmitted() >= sqEntries_) {
+        if (submit() < 0 && errno != EBUSY && errno != EINTR) {
+            return nullptr;
+        }
+    }
+    struct io_uring_sqe* sqe = &sqes_[sqeTail_ & sqMask_];
+    sqeTail_++;
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+unsigned IoUring::published_() const {
+    return __atomic_load_n(sqTail_, __ATOMIC_ACQUIRE) - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+}
+
+int IoUring::submit() {
+    flush();
+    unsigned toSubmit = published_();
+    if (toSubmit == 0) { return 0; }
+    return enter_(toSubmit, 0, 0, nullptr, 0);
+}
+
+int IoUring::wait(int timeoutMs, bool publish) {
+    if (publish) { flush(); }
+    unsigned toSubmit = published_();
+    unsigned minComplete = timeoutMs != 0 && !hasCqe() ? 1 : 0;
+    // DEFER_TASKRUN 下完成事件要靠带 GETEVENTS 的 enter 才会写入 CQ，不等待时也要进一次内核
+    if (toSubmit == 0 && minComplete == 0 && !deferTaskrun_) {
+        return 0;
+    }
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    unsigned flags = IORING_ENTER_GETEVENTS;
+    int ret;
+    if (minComplete > 0 && timeoutMs > 0) {
+        ts.tv_sec = timeoutMs / 1000;
+        ts.tv_nsec = (timeoutMs % 1000) * 1000000LL;
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+        ret = enter_(toSubmit, minComplete, flags | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+    }
+    else {
+        ret = enter_(toSubmit, minComplete, flags, nullptr, 0);
+    }
+    if (ret < 0 && errno != ETIME && errno != EINTR && errno != EBUSY) {
+        return -1;
+    }
+    return 0;
+}
+
+bool IoUring::registerFiles(unsigned count) {
+    struct io_uring_rsrc_register reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.nr = count;
+    reg.flags = IORING_RSRC_REGISTER_SPARSE;
+    return register_(IORING_REGISTER_FILES2, &reg, sizeof(reg)) == 0;
+}
+
+bool IoUring::registerBuffers(const struct iovec* iov, unsigned count) {
+    return register_(IORING_REGISTER_BUFFERS, iov, count) == 0;
+}
+
+bool IoUring::setupBufRing(unsigned entries, uint16_t bgid) {
+    bufRingSize_ = entries * sizeof(struct io_uring_buf);
+    void* addr = mmap(nullptr, bufRingSize_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (addr == MAP_FAILED) {
+        return false;
+    }
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = reinterpret_cast<uint64_t>(addr);
+    reg.ring_entries = entries;
+    reg.bgid = bgid;
+    if (register_(IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+        munmap(addr, bufRingSize_);
+        return false;
+    }
+    bufRing_ = static_cast<struct io_uring_buf_ring*>(addr);
+    bufMask_ = entries - 1;
+    bufTail_ = 0;
+    return true;
+}
+
+void IoUring::provideBuffer(char* addr, unsigned len, uint16_t bid) {
+    // 不用 bufRing_->bufs：uapi 头文件的 __DECLARE_FLEX_ARRAY 在 C++ 下含一个 1 字节的空结构体，bufs 偏移了 8 字节
+    struct io_uring_buf* buf = reinterpret_cast<struct io_uring_buf*>(bufRing_) + (bufTail_ & bufMask_);
+    buf->addr = reinterpret_cast<uint64_t>(addr);
+    buf->len = len;
+    buf->bid = bid;
+    bufTail_++;
+    __atomic_store_n(&bufRing_->tail, bufTail_, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <linux/io_uring.h>
+// <linux/fs.h>(由 io_uring.h 引入)定义了 BLOCK_SIZE 宏，会与 BlockPool::BLOCK_SIZE 冲突
+#undef BLOCK_SIZE
+#include <sys/uio.h>
+
+/*
+io_uring 的最小封装(直接走系统调用，不依赖 liburing)：建环、取 SQE、提交与等待、收割 CQE，
+以及注册固定文件表、固定缓冲区和供 recv 选取的缓冲区环。
+本身不加锁，同一时刻只能有一个线程使用。
+
+getSqe() 取到的 SQE 填好即可，不必单独提交：积压的 SQE 在下一次 submit()/wait() 时
+随同一次 io_uring_enter 批量交给内核。
+*/
+class IoUring {
+public:
+    IoUring() = default;
+    ~IoUring();
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    /*
+    cqEntries 为 0 时取内核默认(SQ 的两倍)。
+    singleIssuer：只由一个线程提交(IORING_SETUP_SINGLE_ISSUER | DEFER_TASKRUN，完成事件
+    只在该线程等待时处理)；环先以禁用状态创建，注册完资源后由该线程调用 enable()。内核不支持时退回普通模式。
+    */
+    bool init(unsigned entries, unsigned cqEntries = 0, bool singleIssuer = false);
+    bool isValid() const { return ringFd_ >= 0; }
+
+    // 支持 IOSQE_CQE_SKIP_SUCCESS：不关心结果的操作成功时不产生 CQE
+    bool canSkipSuccess() const { return features_ & IORING_FEAT_CQE_SKIP; }
+
+    // singleIssuer 模式下由之后负责提交的线程调用一次
+    bool enable();
+
+    // SQ 满时先把已填好的 SQE 提交掉；返回的 SQE 已清零，失败返回 nullptr
+    struct io_uring_sqe* getSqe();
+    unsigned unsubmitted() const;
+
+    // 把已填好的 SQE 发布给内核(只写共享的 tail，不进内核)
+    void flush() { __atomic_store_n(sqTail_, sqeTail_, __ATOMIC_RELEASE); }
+
+    // 提交积压的 SQE，不等待完成
+    int submit();
+
+    /*
+    提交已发布的 SQE 并等待至少一个 CQE；timeoutMs < 0 一直等，0 只处理已完成的。
+    publish 为 false 时不发布本地新填的 SQE：多线程共用时发布在调用方的锁内完成，等待不必持锁
+    */
+    int wait(int timeoutMs, bool publish = true);
+
+    // 依次处理已完成的 CQE，最多 max 个，返回处理的个数
+    template<typename F>
+    unsigned reap(F&& f, unsigned max = ~0u) {
+        unsigned head = *cqHead_;
+        unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+        unsigned n = 0;
+        while (head != tail && n < max) {
+            f(cqes_[head & cqMask_]);
+            head++;
+            n++;
+        }
+        __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+        return n;
+    }
+    bool hasCqe() const { return __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE) != *cqHead_; }
+
+    // 稀疏的固定文件表，之后用 IORING_OP_FILES_UPDATE 按下标填入
+    bool registerFiles(unsigned count);
+
+    // 固定缓冲区，READ_FIXED/WRITE_FIXED 以 buf_index 引用，内核只在注册时 pin 一次
+    bool registerBuffers(const struct iovec* iov, unsigned count);
+
+    // 供 IOSQE_BUFFER_SELECT 选取的缓冲区环(IORING_REGISTER_PBUF_RING)，entries 为 2 的幂
+    bool setupBufRing(unsigned entries, uint16_t bgid);
+    // 把一个缓冲区放回环中，内核在下一次 recv 时可以选用
+    void provideBuffer(char* addr, unsigned len, uint16_t bid);
+
+    // io_uring_enter 的调用次数
+    uint64_t enterCount() const { return enterCount_.load(std::memory_order_relaxed); }
+
+private:
+    unsigned published_() const;
+    int enter_(unsigned toSubmit, unsigned minComplete, unsigned flags, const void* arg, size_t argSize);
+    int register_(unsigned opcode, const void* arg, unsigned nrArgs);
+    bool mapRings_(const struct io_uring_params& p);
+    void release_();
+
+    int ringFd_ = -1;
+    bool deferTaskrun_ = false;     // 完成事件只在带 GETEVENTS 的 enter 里处理
+    unsigned features_ = 0;
+
+    // SQ ring
+    void* sqRing_ = nullptr;
+    size_t sqRingSize_ = 0;
+    unsigned* sqHead_ = nullptr;
+    unsigned* sqTail_ = nullptr;
+    unsigned sqMask_ = 0;
+    unsigned sqEntries_ = 0;
+    struct io_uring_sqe* sqes_ = nullptr;
+    size_t sqesSize_ = 0;
+    unsigned sqeTail_ = 0;  // 本地 tail，提交时才发布到 *sqTail_
+
+    // CQ ring
+    void* cqRing_ = nullptr;
+    size_t cqRingSize_ = 0;
+    unsigned* cqHead_ = nullptr;
+    unsigned* cqTail_ = nullptr;
+    unsigned cqMask_ = 0;
+    struct io_uring_cqe* cqes_ = nullptr;
+
+    // 缓冲区环
+    struct io_uring_buf_ring* bufRing_ = nullptr;
+    size_t bufRingSize_ = 0;
+    unsigned bufMask_ = 0;
+    uint16_t bufTail_ = 0;
+
+    std::atomic<uint64_t> enterCount_{0};
+};
@@ -0,0 +1,22 @@
+#include "poller.h"
+#include "epoller.h"
+#include "uringpoller.h"
+#include "../log/log.h"
+
+std::unique_ptr<Poller> Poller::create(BACKEND backend, int maxEvent) {
+    if (backend == IO_URING) {
+        auto poller = std::make_unique<UringPoller>(maxEvent);
+        if (poller->isValid()) {
+            return poller;
+        }
+        LOG_WARN("io_uring unavailable, fall back to epoll!");
+    }
+    return std::make_unique<Epoller>(maxEvent);
+}
+
+const char* Poller::backendName(BACKEND backend) {
+    switch (backend) {
+        case IO_URING: return "io_uring";
+        default: return "epoll";
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <sys/epoll.h>
+
+/*
+I/O 多路复用后端的统一接口，事件语义沿用 epoll：
+EPOLLIN/EPOLLOUT/EPOLLRDHUP/EPOLLET/EPOLLONESHOT
+注册时可附带 ptr(同 epoll_event.data.ptr)，之后用 getEventPtr 取回；
+不带 ptr 注册的 fd 用 getEventFd 取回，二者共用同一份存储，不能混用
+*/
+class Poller {
+public:
+    enum BACKEND {
+        EPOLL = 0,
+        IO_URING,
+    };
+
+    virtual ~Poller() = default;
+
+    virtual bool addFd(int fd, uint32_t events, void* ptr = nullptr) = 0;
+
+    virtual bool modFd(int fd, uint32_t events, void* ptr = nullptr) = 0;
+
+    virtual bool delFd(int fd) = 0;
+
+    virtual int wait(int timeoutMs = -1) = 0;
+
+    virtual int getEventFd(size_t idx) const = 0;
+
+    virtual void* getEventPtr(size_t idx) const = 0;
+
+    virtual uint32_t getEvents(size_t idx) const = 0;
+
+    /* io_uring 不可用时退回 epoll */
+    static std::unique_ptr<Poller> create(BACKEND backend, int maxEvent = 1024);
+
+    static const char* backendName(BACKEND backend);
+
+    /* 注册类操作次数：epoll 为 epoll_ctl 调用数，io_uring 为 POLL_ADD/POLL_REMOVE SQE 数 */
+    uint64_t ctlCount() const { return ctlCount_.load(std::memory_order_relaxed); }
+
+    /* 进入内核的次数：epoll 为 epoll_wait + epoll_ctl，io_uring 为 io_uring_enter */
+    virtual uint64_t syscallCount() const = 0;
+
+protected:
+    std::atomic<uint64_t> ctlCount_{0};
+};
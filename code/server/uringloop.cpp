@@ -0,0 +1,416 @@
+/*
+EventLoop 的 io_uring 完成模式(说明见 eventloop.h)。
+所有 SQE 只由 loop 线程填写，随下一次 wait 一起提交；CQE 按 user_data 中的操作类型分派。
+一个连接同一时刻至多挂着一个 multishot recv 和一个发送/文件读取，inflight 记录还会回来的 CQE 数，
+关闭时等它归零才释放槽位、关闭 fd，因此 fd 在所有 CQE 回来之前不会被新连接复用。
+*/
+#include "eventloop.h"
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <linux/tcp.h>     // tcp_info::tcpi_bytes_acked，glibc 的 netinet/tcp.h 没有
+
+// user_data：高 32 位为操作类型，低 32 位为 fd(连接槽下标)
+enum URING_OP : uint32_t {
+    OP_IGNORE = 0,  // 关闭/取消/更新固定文件表，成功时不产生 CQE
+    OP_ACCEPT,
+    OP_RECV,
+    OP_SEND,
+    OP_READ,
+};
+
+static inline uint64_t makeUserData(URING_OP op, int fd) {
+    return (static_cast<uint64_t>(op) << 32) | static_cast<uint32_t>(fd);
+}
+
+bool EventLoop::initUring_() {
+    uring_ = std::make_unique<IoUring>();
+    // 只由本 loop 线程提交：SINGLE_ISSUER | DEFER_TASKRUN，完成事件只在 wait 时处理
+    if (!uring_->init(URING_ENTRIES, URING_ENTRIES * 8, true)) {
+        return false;
+    }
+    // 固定文件表以 fd 为下标；内核要求表大小不超过 RLIMIT_NOFILE，fd 也不会超过它
+    fixedFiles_ = MAX_FD;
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < fixedFiles_) {
+        fixedFiles_ = static_cast<unsigned>(rl.rlim_cur);
+    }
+    if (!uring_->registerFiles(fixedFiles_) || !uring_->setupBufRing(RECV_BUFS, RECV_GROUP)) {
+        return false;
+    }
+    recvBufs_.resize(RECV_BUFS);
+    for (unsigned i = 0; i < RECV_BUFS; i ++) {
+        recvBufs_[i] = BlockPool::Instance()->Get();
+        uring_->provideBuffer(recvBufs_[i], BlockPool::BLOCK_SIZE, i);
+    }
+
+    void* addr = mmap(nullptr, FILE_BUFS * FILE_BUF_SIZE, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (addr == MAP_FAILED) {
+        return false;
+    }
+    fileBufBase_ = static_cast<char*>(addr);
+    struct iovec iov[FILE_BUFS];
+    for (int i = 0; i < FILE_BUFS; i ++) {
+        iov[i].iov_base = fileBufBase_ + i * FILE_BUF_SIZE;
+        iov[i].iov_len = FILE_BUF_SIZE;
+        freeFileBufs_.push_back(i);
+    }
+    // 注册要 pin 住内存，超出 RLIMIT_MEMLOCK 时失败，退回普通 READ，缓冲区照用
+    fixedBufs_ = uring_->registerBuffers(iov, FILE_BUFS);
+    LOG_INFO("io_uring completion mode: %u fixed files, %u recv blocks, %d x %zuKB file buffers%s",
+            fixedFiles_, RECV_BUFS, FILE_BUFS, FILE_BUF_SIZE / 1024, fixedBufs_ ? "" : " (not registered)");
+    return true;
+}
+
+void EventLoop::releaseUring_() {
+    // 先销毁环，内核不再引用缓冲区
+    uring_.reset();
+    for (char* block : recvBufs_) {
+        BlockPool::Instance()->Put(block);
+    }
+    recvBufs_.clear();
+    if (fileBufBase_) {
+        munmap(fileBufBase_, FILE_BUFS * FILE_BUF_SIZE);
+        fileBufBase_ = nullptr;
+    }
+    freeFileBufs_.clear();
+}
+
+void EventLoop::loopUring_() {
+    // 环以禁用状态创建，由实际提交的线程启用
+    if (!uring_->enable()) {
+        LOG_ERROR("Enable io_uring error!");
+        return;
+    }
+    uringArmAccept_();
+    while (!isClose_) {
+        // 本轮处理 CQE 时填的 SQE 与等待合并成一次 io_uring_enter
+        uring_->wait(nextTimeout_());
+        uring_->reap([this](const struct io_uring_cqe& cqe) { onCqe_(cqe); });
+        serveFileBufWaiters_();
+    }
+}
+
+void EventLoop::onCqe_(const struct io_uring_cqe& cqe) {
+    URING_OP op = static_cast<URING_OP>(cqe.user_data >> 32);
+    int fd = static_cast<int>(cqe.user_data & 0xffffffff);
+    switch (op) {
+        case OP_ACCEPT:
+            onUringAccept_(cqe.res, cqe.flags);
+            break;
+        case OP_RECV:
+            onUringRecv_(&users_[fd], cqe.res, cqe.flags);
+            break;
+        case OP_SEND:
+            onUringSend_(&users_[fd], cqe.res);
+            break;
+        case OP_READ:
+            onUringFileRead_(&users_[fd], cqe.res);
+            break;
+        default:
+            // 取消时没有挂着的操作(-ENOENT)是正常的
+            if (cqe.res < 0 && cqe.res != -ENOENT) {
+                LOG_DEBUG("io_uring op on fd %d failed: %d", fd, cqe.res);
+            }
+            break;
+    }
+}
+
+void EventLoop::uringArmAccept_() {
+    struct io_uring_sqe* sqe = uring_->getSqe();
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listenFd_;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->user_data = makeUserData(OP_ACCEPT, listenFd_);
+}
+
+/* install 为 true 时先把 fd 填进固定文件表，与 recv 链接，保证 recv 执行时表项已就位 */
+void EventLoop::uringArmRecv_(ConnSlot* slot, bool install) {
+    uint8_t skip = uring_->canSkipSuccess() ? IOSQE_CQE_SKIP_SUCCESS : 0;
+    struct io_uring_sqe* sqe;
+    if (install) {
+        sqe = uring_->getSqe();
+        if (!sqe) return;
+        sqe->opcode = IORING_OP_FILES_UPDATE;
+        sqe->fd = -1;
+        sqe->addr = reinterpret_cast<uint64_t>(&slot->fd);
+        sqe->len = 1;
+        sqe->off = slot->fd;
+        sqe->flags = IOSQE_IO_LINK | skip;
+        sqe->user_data = makeUserData(OP_IGNORE, slot->fd);
+    }
+    sqe = uring_->getSqe();
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = slot->fd;
+    sqe->flags = IOSQE_FIXED_FILE | IOSQE_BUFFER_SELECT;
+    sqe->buf_group = RECV_GROUP;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->user_data = makeUserData(OP_RECV, slot->fd);
+    slot->recving = true;
+    slot->inflight ++;
+}
+
+void EventLoop::onUringAccept_(int res, uint32_t flags) {
+    // multishot accept 被内核终止(出错、环满)时重新提交
+    if (!(flags & IORING_CQE_F_MORE) && !isClose_) {
+        uringArmAccept_();
+    }
+    if (res < 0) {
+        LOG_WARN("Accept error: %d", res);
+        return;
+    }
+    int fd = res;
+    if (HttpConn::userCount >= MAX_FD || fd >= static_cast<int>(fixedFiles_)) {
+        sendError_(fd, "Server is busy!");
+        LOG_WARN("Server is full!");
+        return;
+    }
+    // multishot accept 的地址参数被每次 accept 共用，对端地址单独取
+    struct sockaddr_in clientAddr = {};
+    socklen_t addrLen = sizeof(clientAddr);
+    getpeername(fd, (sockaddr*)&clientAddr, &addrLen);
+    syscalls_.fetch_add(1, std::memory_order_relaxed);
+    addClient_(fd, clientAddr);
+}
+
+void EventLoop::onUringRecv_(ConnSlot* slot, int res, uint32_t flags) {
+    if (!(flags & IORING_CQE_F_MORE)) {
+        slot->recving = false;
+        slot->inflight --;
+    }
+    char* block = nullptr;
+    uint16_t bid = 0;
+    if (flags & IORING_CQE_F_BUFFER) {
+        bid = static_cast<uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT);
+        block = recvBufs_[bid];
+    }
+    if (slot->state & CLOSED) {
+        // 关闭后才回来的数据丢弃，块放回环中
+        if (block) uring_->provideBuffer(block, BlockPool::BLOCK_SIZE, bid);
+        if (slot->inflight == 0) uringFinishClose_(slot);
+        return;
+    }
+    if (res <= 0) {
+        if (block) uring_->provideBuffer(block, BlockPool::BLOCK_SIZE, bid);
+        if (res == -ENOBUFS) {
+            // 缓冲区环暂时取空，本轮处理完的块已放回，重新挂上 recv
+            if (!slot->recving) uringArmRecv_(slot, false);
+            return;
+        }
+        uringClose_(slot);  // 对端关闭或出错
+        return;
+    }
+    assert(block);
+    // 块直接挂到读缓冲区，环中补一个新块
+    char* back = slot->conn->appendRead(block, res);
+    recvBufs_[bid] = back ? back : BlockPool::Instance()->Get();
+    uring_->provideBuffer(recvBufs_[bid], BlockPool::BLOCK_SIZE, bid);
+    extendTime_(slot);
+    if (!slot->recving) {
+        uringArmRecv_(slot, false);
+    }
+    // 发送在途时只收数据，发完后再解析(写缓冲区正被发送引用)
+    if (!slot->sending) {
+        uringProcess_(slot);
+    }
+}
+
+/* 没有在途的发送：写完积压的响应，或解析读缓冲区里的下一批请求 */
+void EventLoop::uringProcess_(ConnSlot* slot) {
+    HttpConn* client = slot->conn.get();
+    if (client->toWriteBytes() == 0) {
+        int n = client->process();
+        if (n == 0) {
+            return;
+        }
+        requests_.fetch_add(n, std::memory_order_relaxed);
+    }
+    uringSend_(slot);
+}
+
+void EventLoop::uringSend_(ConnSlot* slot) {
+    assert(!slot->sending);
+    HttpConn* client = slot->conn.get();
+    const struct msghdr* msg = nullptr;
+    bool more = false;
+    int fileFd = -1;
+    off_t off = 0;
+    size_t len = 0;
+    if (slot->fileOff == slot->fileLen) {
+        msg = client->prepSend(&more, &fileFd, &off, &len);
+        // 队首是文件体：分块读进固定缓冲区，读完再发送；已有连接在排队时不插队
+        if (!msg && slot->fileBuf < 0) {
+            if (freeFileBufs_.empty() || !fileBufWaiters_.empty()) {
+                slot->sending = true;
+                fileBufWaiters_.emplace_back(slot, slot->gen.load());
+                return;
+            }
+            slot->fileBuf = freeFileBufs_.back();
+            freeFileBufs_.pop_back();
+        }
+    }
+    struct io_uring_sqe* sqe = uring_->getSqe();
+    if (!sqe) return;
+    char* buf = fileBufBase_ + slot->fileBuf * FILE_BUF_SIZE;
+    if (slot->fileOff < slot->fileLen) {
+        // 固定缓冲区里读入的文件内容
+        uint32_t left = slot->fileLen - slot->fileOff;
+        sqe->opcode = IORING_OP_SEND;
+        sqe->fd = slot->fd;
+        sqe->flags = IOSQE_FIXED_FILE;
+        sqe->addr = reinterpret_cast<uint64_t>(buf + slot->fileOff);
+        sqe->len = left;
+        sqe->msg_flags = client->toWriteBytes() > left ? MSG_MORE : 0;
+        sqe->user_data = makeUserData(OP_SEND, slot->fd);
+    }
+    else if (msg) {
+        // 后面紧跟文件体时带 MSG_MORE，让响应头与文件开头合并成一个报文
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = slot->fd;
+        sqe->flags = IOSQE_FIXED_FILE;
+        sqe->addr = reinterpret_cast<uint64_t>(msg);
+        sqe->len = 1;
+        sqe->msg_flags = more ? MSG_MORE : 0;
+        sqe->user_data = makeUserData(OP_SEND, slot->fd);
+    }
+    else {
+        sqe->opcode = fixedBufs_ ? IORING_OP_READ_FIXED : IORING_OP_READ;
+        sqe->fd = fileFd;
+        sqe->addr = reinterpret_cast<uint64_t>(buf);
+        sqe->len = static_cast<uint32_t>(std::min(len, FILE_BUF_SIZE));
+        sqe->off = off;
+        sqe->buf_index = fixedBufs_ ? slot->fileBuf : 0;
+        sqe->user_data = makeUserData(OP_READ, slot->fd);
+    }
+    slot->sending = true;
+    slot->inflight ++;
+}
+
+void EventLoop::onUringSend_(ConnSlot* slot, int res) {
+    slot->inflight --;
+    slot->sending = false;
+    if (slot->state & CLOSED) {
+        if (slot->inflight == 0) uringFinishClose_(slot);
+        return;
+    }
+    if (res <= 0) {
+        uringClose_(slot);
+        return;
+    }
+    HttpConn* client = slot->conn.get();
+    client->onSent(res);
+    if (slot->fileOff < slot->fileLen) {
+        slot->fileOff += res;
+        // 一块发完，有连接在等固定缓冲区时让出，自己排到队尾
+        if (slot->fileOff == slot->fileLen && !fileBufWaiters_.empty()) {
+            releaseFileBuf_(slot);
+        }
+    }
+    extendTime_(slot);
+    if (client->toWriteBytes() > 0) {
+        uringSend_(slot);
+        return;
+    }
+    releaseFileBuf_(slot);
+    if (!client->isKeepAlive()) {
+        uringClose_(slot);
+        return;
+    }
+    uringProcess_(slot);    // 发送期间到达的流水线请求
+}
+
+void EventLoop::onUringFileRead_(ConnSlot* slot, int res) {
+    slot->inflight --;
+    slot->sending = false;
+    if (slot->state & CLOSED) {
+        if (slot->inflight == 0) uringFinishClose_(slot);
+        return;
+    }
+    if (res <= 0) {
+        // 文件被截断或读出错，响应已无法完整发出
+        LOG_WARN("Client[%d] read file error: %d", slot->fd, res);
+        uringClose_(slot);
+        return;
+    }
+    slot->fileOff = 0;
+    slot->fileLen = static_cast<uint32_t>(res);
+    uringSend_(slot);
+}
+
+/* 取消连接上挂着的操作，全部 CQE 回来后由 uringFinishClose_ 关闭 fd */
+void EventLoop::uringClose_(ConnSlot* slot) {
+    if (slot->state & CLOSED) return;
+    LOG_INFO("Client[%d] quit!", slot->fd);
+    slot->gen ++;
+    slot->state = CLOSED;
+    if (slot->inflight == 0) {
+        uringFinishClose_(slot);
+        return;
+    }
+    struct io_uring_sqe* sqe = uring_->getSqe();
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = slot->fd;
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_FD_FIXED | IORING_ASYNC_CANCEL_ALL;
+    sqe->flags = uring_->canSkipSuccess() ? IOSQE_CQE_SKIP_SUCCESS : 0;
+    sqe->user_data = makeUserData(OP_IGNORE, slot->fd);
+}
+
+void EventLoop::uringFinishClose_(ConnSlot* slot) {
+    assert(slot->inflight == 0);
+    releaseFileBuf_(slot);
+    slot->conn->closeConn(false);
+    // 先清掉固定文件表中的引用(它也持有 socket)，再关闭 fd；HARDLINK 保证前者失败时后者照常执行
+    uint8_t skip = uring_->canSkipSuccess() ? IOSQE_CQE_SKIP_SUCCESS : 0;
+    struct io_uring_sqe* sqe = uring_->getSqe();
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->file_index = slot->fd + 1;
+    sqe->flags = IOSQE_IO_HARDLINK | skip;
+    sqe->user_data = makeUserData(OP_IGNORE, slot->fd);
+    sqe = uring_->getSqe();
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->fd = slot->fd;
+    sqe->flags = skip;
+    sqe->user_data = makeUserData(OP_IGNORE, slot->fd);
+}
+
+/* 超时检查：在等固定缓冲区，或自上次检查以来对端又确认了数据(TCP_INFO) */
+bool EventLoop::uringSendProgressed_(ConnSlot* slot) {
+    if (slot->inflight == 0) {
+        return true;
+    }
+    struct tcp_info info;
+    socklen_t len = sizeof(info);
+    syscalls_.fetch_add(1, std::memory_order_relaxed);
+    if (getsockopt(slot->fd, IPPROTO_TCP, TCP_INFO, &info, &len) < 0 || info.tcpi_bytes_acked == slot->acked) {
+        return false;
+    }
+    slot->acked = info.tcpi_bytes_acked;
+    return true;
+}
+
+void EventLoop::releaseFileBuf_(ConnSlot* slot) {
+    if (slot->fileBuf >= 0) {
+        freeFileBufs_.push_back(slot->fileBuf);
+        slot->fileBuf = -1;
+    }
+    slot->fileOff = slot->fileLen = 0;
+}
+
+/* 每轮 CQE 处理完后把空出的固定缓冲区交给等待的连接，按排队顺序 */
+void EventLoop::serveFileBufWaiters_() {
+    while (!freeFileBufs_.empty() && !fileBufWaiters_.empty()) {
+        auto [slot, gen] = fileBufWaiters_.front();
+        fileBufWaiters_.pop_front();
+        if (slot->gen != gen) continue;     // 等待期间连接已关闭
+        // 直接分给队首，uringSend_ 见到已有缓冲区就不再排队
+        slot->fileBuf = freeFileBufs_.back();
+        freeFileBufs_.pop_back();
+        slot->sending = false;
+        uringSend_(slot);
+    }
+}
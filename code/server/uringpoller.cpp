@@ -0,0 +1,154 @@
+#include "uringpoller.h"
+
+// user_data: 高 32 位为 gen，低 32 位为 fd；最高位标记 POLL_REMOVE 自身的完成事件
+static const uint64_t REMOVE_TAG = 1ULL << 63;
+static const uint32_t GEN_MASK = 0x7fffffff;
+
+static inline uint64_t makeUserData(int fd, uint32_t gen) {
+    return (static_cast<uint64_t>(gen & GEN_MASK) << 32) | static_cast<uint32_t>(fd);
+}
+
+UringPoller::UringPoller(int maxEvent): events_(maxEvent) {
+    assert(events_.size() > 0);
+    // CQ 放大，multishot poll 在一次 wait 间隔内可能产生多个 CQE
+    ring_.init(static_cast<unsigned>(maxEvent), static_cast<unsigned>(maxEvent) * 4);
+}
+
+void UringPoller::prepPoll_(int fd) {
+    FdState& st = fdStates_[fd];
+    struct io_uring_sqe* sqe = ring_.getSqe();
+    if (!sqe) return;
+    uint32_t events = st.events & ~(EPOLLONESHOT | EPOLLET);
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    if (!(st.events & EPOLLONESHOT) && (st.events & EPOLLET)) {
+        sqe->len = IORING_POLL_ADD_MULTI;
+        events |= EPOLLET;
+    }
+    sqe->poll32_events = events;
+    sqe->user_data = makeUserData(fd, st.gen);
+    ctlCount_.fetch_add(1, std::memory_order_relaxed);
+    st.armed = true;
+}
+
+void UringPoller::prepRemove_(int fd) {
+    FdState& st = fdStates_[fd];
+    struct io_uring_sqe* sqe = ring_.getSqe();
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = makeUserData(fd, st.gen);
+    sqe->user_data = REMOVE_TAG;
+    ctlCount_.fetch_add(1, std::memory_order_relaxed);
+    st.armed = false;
+}
+
+void UringPoller::submitIfForeign_() {
+    // loop 线程自己的修改留到 wait() 批量提交，其他线程等不到下一次 wait，立即提交
+    if (std::this_thread::get_id() != owner_) {
+        ring_.submit();
+    }
+}
+
+bool UringPoller::addFd(int fd, uint32_t events, void* ptr) {
+    if (fd < 0) return false;
+    std::lock_guard<std::mutex> locker(mtx_);
+    if (static_cast<size_t>(fd) >= fdStates_.size()) {
+        fdStates_.resize(fd + 1);
+    }
+    FdState& st = fdStates_[fd];
+    if (st.armed) {
+        prepRemove_(fd);
+    }
+    st.gen ++;
+    st.events = events;
+    st.ptr = ptr;
+    prepPoll_(fd);
+    submitIfForeign_();
+    return true;
+}
+
+bool UringPoller::modFd(int fd, uint32_t events, void* ptr) {
+    if (fd < 0) return false;
+    std::lock_guard<std::mutex> locker(mtx_);
+    if (static_cast<size_t>(fd) >= fdStates_.size()) return false;
+    FdState& st = fdStates_[fd];
+    if (st.armed) {
+        prepRemove_(fd);
+    }
+    st.gen ++;
+    st.events = events;
+    st.ptr = ptr;
+    prepPoll_(fd);
+    submitIfForeign_();
+    return true;
+}
+
+bool UringPoller::delFd(int fd) {
+    if (fd < 0) return false;
+    std::lock_guard<std::mutex> locker(mtx_);
+    if (static_cast<size_t>(fd) >= fdStates_.size()) return false;
+    FdState& st = fdStates_[fd];
+    if (st.armed) {
+        prepRemove_(fd);
+    }
+    st.gen ++;
+    st.events = 0;
+    st.ptr = nullptr;
+    submitIfForeign_();
+    return true;
+}
+
+int UringPoller::wait(int timeoutMs) {
+    {
+        // 在锁内发布积压的 SQE，等待时与提交合并为一次 io_uring_enter
+        std::lock_guard<std::mutex> locker(mtx_);
+        owner_ = std::this_thread::get_id();
+        ring_.flush();
+    }
+    // 阻塞等待时不持锁，工作线程的 modFd 自行提交
+    if (ring_.wait(timeoutMs, false) < 0) {
+        return -1;
+    }
+
+    // 收割 CQE，转换成 epoll_event，过期(gen 不符)或被取消的直接丢弃
+    std::lock_guard<std::mutex> locker(mtx_);
+    int cnt = 0;
+    ring_.reap([&](const struct io_uring_cqe& cqe) {
+        if (cqe.user_data & REMOVE_TAG) return;
+        int fd = static_cast<int>(cqe.user_data & 0xffffffff);
+        uint32_t gen = static_cast<uint32_t>(cqe.user_data >> 32) & GEN_MASK;
+        if (static_cast<size_t>(fd) >= fdStates_.size()) return;
+        FdState& st = fdStates_[fd];
+        if ((st.gen & GEN_MASK) != gen || cqe.res == -ECANCELED) return;
+
+        bool more = cqe.flags & IORING_CQE_F_MORE;
+        if (!more) {
+            st.armed = false;
+            // LT 与被内核终止的 multishot：重新注册，随下一次 wait 提交
+            if (!(st.events & EPOLLONESHOT)) {
+                prepPoll_(fd);
+            }
+        }
+        if (st.ptr) events_[cnt].data.ptr = st.ptr;
+        else events_[cnt].data.fd = fd;
+        events_[cnt].events = cqe.res < 0 ? EPOLLERR : static_cast<uint32_t>(cqe.res);
+        cnt ++;
+    }, static_cast<unsigned>(events_.size()));
+    return cnt;
+}
+
+int UringPoller::getEventFd(size_t idx) const {
+    assert(idx < events_.size());
+    return events_[idx].data.fd;
+}
+
+void* UringPoller::getEventPtr(size_t idx) const {
+    assert(idx < events_.size());
+    return events_[idx].data.ptr;
+}
+
+uint32_t UringPoller::getEvents(size_t idx) const {
+    assert(idx < events_.size());
+    return events_[idx].events;
+}
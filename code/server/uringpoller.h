@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <assert.h>
+#include <errno.h>
+
+#include "poller.h"
+#include "iouring.h"
+
+/*
+基于 io_uring IORING_OP_POLL_ADD 的就绪通知后端(直接走系统调用，不依赖 liburing)。
+addFd/modFd/delFd 只往 SQ 里填 SQE，由 loop 线程在下一次 wait() 时
+与等待合并成一次 io_uring_enter 批量提交；其他线程(线程池)调用时立即提交。
+
+epoll 语义映射：
+    EPOLLONESHOT     -> 单次 poll，触发后需 modFd 重新注册
+    EPOLLET          -> multishot poll，每次唤醒产生一个 CQE
+    LT               -> 单次 poll，触发后在下一次 wait() 自动重新注册
+
+这是线程池模式下的 io_uring 后端(读写仍由工作线程直接调用)；one loop per thread 模式下
+EventLoop 改用完成模式，accept/recv/send/文件读取都以 SQE 提交，见 EventLoop 的说明。
+*/
+class UringPoller : public Poller {
+public:
+    explicit UringPoller(int maxEvent = 1024);
+
+    ~UringPoller() override = default;
+
+    bool isValid() const { return ring_.isValid(); }
+
+    bool addFd(int fd, uint32_t events, void* ptr = nullptr) override;
+
+    bool modFd(int fd, uint32_t events, void* ptr = nullptr) override;
+
+    bool delFd(int fd) override;
+
+    int wait(int timeoutMs = -1) override;
+
+    int getEventFd(size_t idx) const override;
+
+    void* getEventPtr(size_t idx) const override;
+
+    uint32_t getEvents(size_t idx) const override;
+
+    uint64_t syscallCount() const override { return ring_.enterCount(); }
+
+private:
+    struct FdState {
+        uint32_t events = 0;
+        void* ptr = nullptr;    // 注册时附带的 data.ptr
+        uint32_t gen = 0;       // 每次重新注册递增，用于丢弃过期的 CQE
+        bool armed = false;     // 内核中是否还有挂着的 poll
+    };
+
+    void prepPoll_(int fd);
+    void prepRemove_(int fd);
+    void submitIfForeign_();
+
+    IoUring ring_;
+    std::mutex mtx_;    // 保护 ring_ 的 SQ 与 fdStates_，线程池模式下 modFd 来自工作线程
+    std::thread::id owner_; // 调用 wait() 的 loop 线程
+    std::vector<FdState> fdStates_;
+    std::vector<struct epoll_event> events_;
+};
@@ -4,11 +4,11 @@
 WebServer::WebServer(int port, int mode, int timeoutMs, bool optLinger,
         int sqlPort, const char* sqlUser, const char* sqlPwd, const char* dbName,
         int connPoolSize, int threadPoolSize,
-        bool openLog, int logLevel, int logQueueSize):
-        port_(port), timeoutMs_(timeoutMs), openLinger_(optLinger),
-        isClose_(false), timer_(std::make_unique<HeapTimer>()),
-        threadpool_(std::make_unique<ThreadPool>(threadPoolSize)),
-        epoller_(std::make_unique<Epoller>())  {
+        bool openLog, int logLevel, int logQueueSize, int loopNum,
+        Poller::BACKEND backend, bool oneShot, long sendfileThreshold,
+        long contentCacheBytes, bool hugePages, Log::FORMAT_MODE logFormat,
+        Log::OVERFLOW_POLICY logOverflow, int logSampleN, int logFlushMs, int logFsyncMs):
+        port_(port), isClose_(false) {
     srcDir_ = getcwd(nullptr, 256);
     assert(srcDir_);
     strncat(srcDir_, "/../../resources", 20);
@@ -16,152 +16,107 @@ WebServer::WebServer(int port, int mode, int timeoutMs, bool optLinger,
     HttpConn::srcDir = srcDir_;
     SqlConnPool::Instance()->init("localhost", sqlPort, sqlUser, 
     sqlPwd, dbName, connPoolSize);
-    initEventModel_(mode);
-    if (!initSocket_()) { isClose_ = true; }
+    initEventModel_(mode, oneShot);
+    BlockPool::Instance()->init(hugePages);
+    // 先打开日志，listen socket / Poller 初始化的错误才能记下来
+    if (openLog) {
+        Log::Instance().init(logLevel, "./log", logFormat == Log::BINARY ? ".blog" : ".log",
+                logQueueSize, logFormat);
+        // 默认 DROP_BY_LEVEL：磁盘跟不上时丢弃 debug/info，不让日志拖住请求处理；warn/error 不丢
+        Log::Instance().SetOverflowPolicy(logOverflow, logSampleN);
+        Log::Instance().SetFlushInterval(logFlushMs, logFsyncMs);
+    }
+    // 对端关闭后 writev/sendfile 会触发 SIGPIPE，默认动作是终止进程
+    signal(SIGPIPE, SIG_IGN);
+    // 小文件交给 ContentCache 读入内存，FileCache 不再映射它们
+    ContentCache::Instance()->init(contentCacheBytes > 0 ? contentCacheBytes : 0);
+    Compressor::Instance()->init();     // gzip 变体在后台压缩后放入 ContentCache
+    FileCache::Instance()->init(srcDir_,
+            ContentCache::Instance()->enabled() ? ContentCache::MAX_OBJECT : 0,
+            sendfileThreshold < 0 ? SIZE_MAX : static_cast<size_t>(sendfileThreshold));
+    HttpResponse::loadErrorPages();
+
+    if (loopNum <= 0) {
+        // 单 Reactor：主线程 epoll，读写交给线程池
+        threadpool_ = std::make_unique<ThreadPool>(threadPoolSize);
+        loops_.push_back(std::make_unique<EventLoop>(port_, listenEvent_, connEvent_,
+                timeoutMs, optLinger, false, threadpool_.get(), backend));
+    }
+    else {
+        // 多 Reactor：每个 loop 各自持有 SO_REUSEPORT 的 listen fd，不经过线程池
+        for (int i = 0; i < loopNum; i ++) {
+            loops_.push_back(std::make_unique<EventLoop>(port_, listenEvent_, connEvent_,
+                    timeoutMs, optLinger, true, nullptr, backend));
+        }
+    }
+    for (auto& loop : loops_) {
+        if (!loop->init()) { isClose_ = true; }
+    }
 
     if (openLog) {
-        Log::Instance().init(logLevel, "./log", ".log", logQueueSize);
         if(isClose_) { LOG_ERROR("========== Server init error!=========="); }
         else {
             LOG_INFO("========== Server init ==========");
             LOG_INFO("Port:%d, OpenLinger: %s", port_, optLinger? "true":"false");
-            LOG_INFO("Listen Mode: %s, OpenConn Mode: %s",
+            LOG_INFO("Listen Mode: %s, OpenConn Mode: %s%s",
                             (listenEvent_ & EPOLLET ? "ET": "LT"),
-                            (connEvent_ & EPOLLET ? "ET": "LT"));
-            LOG_INFO("LogSys level: %d", logLevel);
+                            (connEvent_ & EPOLLET ? "ET": "LT"),
+                            (connEvent_ & EPOLLONESHOT ? " + ONESHOT": ""));
+            LOG_INFO("Poller backend: %s", Poller::backendName(backend));
+            LOG_INFO("LogSys level: %d, format: %s", logLevel,
+                    logFormat == Log::BINARY ? "binary" : (logFormat == Log::DEFERRED ? "deferred" : "text"));
+            static const char* const OVERFLOW_NAME[] = {"block", "drop newest", "drop by level", "sample"};
+            if (logOverflow == Log::SAMPLE) { LOG_INFO("Log overflow: sample 1 in %d", std::max(logSampleN, 1)); }
+            else { LOG_INFO("Log overflow: %s", OVERFLOW_NAME[logOverflow]); }
+            if (logFsyncMs > 0) { LOG_INFO("Log flush: every %dms, fsync every %dms", std::max(logFlushMs, 1), logFsyncMs); }
+            else { LOG_INFO("Log flush: every %dms, fsync off", std::max(logFlushMs, 1)); }
             LOG_INFO("srcDir: %s", HttpConn::srcDir);
-            LOG_INFO("SqlConnPool num: %d, ThreadPool num: %d", connPoolSize, threadPoolSize);
+            if (sendfileThreshold < 0) { LOG_INFO("File body: mmap + writev"); }
+            else { LOG_INFO("File body: sendfile for files >= %ld bytes", sendfileThreshold); }
+            if (ContentCache::Instance()->enabled()) {
+                LOG_INFO("ContentCache: files < %zu bytes, budget %ld bytes",
+                        ContentCache::MAX_OBJECT, contentCacheBytes);
+            }
+            else { LOG_INFO("ContentCache: off"); }
+            LOG_INFO("Read buffer blocks: %zu bytes%s", BlockPool::BLOCK_SIZE, hugePages ? ", huge pages" : "");
+            if (threadpool_) {
+                LOG_INFO("SqlConnPool num: %d, ThreadPool num: %d", connPoolSize, threadPoolSize);
+            }
+            else {
+                LOG_INFO("SqlConnPool num: %d, EventLoop num: %d", connPoolSize, loopNum);
+            }
         }
     }
 }
 
 WebServer::~WebServer() {
     isClose_ = true;
-    close(listenFd_);
+    loops_.clear();
+    Compressor::Instance()->close();
+    FileCache::Instance()->close();
     free(srcDir_);
     SqlConnPool::Instance()->closePool();
 }
 
 void WebServer::start() {
-    int timeMS = -1;    // epoll wait time,无事件将阻塞
-    if (!isClose_) {
-        LOG_INFO("========== Server start ==========");
-    }
-    while(!isClose_) {
-        if (timeoutMs_ > 0) {
-            timeMS = timer_->getNextTick();
-        }
-        int eventCnt = epoller_->wait(timeMS);
-        for (int i = 0; i < eventCnt; i ++) {
-            int fd = epoller_->getEventFd(i);
-            uint32_t events = epoller_->getEvents(i);
-            if (fd == listenFd_) {
-                // 新连接事件
-                dealListen_();
-            }
-            else if (events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
-                // 断连事件
-                assert(users_.count(fd) > 0);
-                dealDisconnect_(&users_[fd]);
-            }
-            else if (events & EPOLLIN) {
-                // 输入事件
-                assert(users_.count(fd) > 0);
-                dealRead_(&users_[fd]);
-            }
-            else if (events & EPOLLOUT) {
-                // 写出事件
-                assert(users_.count(fd) > 0);
-                dealWrite_(&users_[fd]);
-            }
-            else {
-                // UB
-                LOG_ERROR("Unexpected event!");
-            }
-        }
-    }
-}
-
-int WebServer::setFdNonBlock(int fd) {
-    assert(fd > 0);
-    int oldOpt = fcntl(fd, F_GETFL);
-    assert(oldOpt >= 0);
-    return fcntl(fd, F_SETFL, oldOpt | O_NONBLOCK);
-}
-
-/* Create listen fd*/
-bool WebServer::initSocket_() {
-    int ret;
-    struct sockaddr_in addr;
-
-    if(port_ > 65535 || port_ < 1024) {
-        LOG_ERROR("Port:%d error!",  port_);
-        return false;
-    }
-    addr.sin_family = AF_INET;
-    addr.sin_addr.s_addr = htonl(INADDR_ANY);
-    addr.sin_port = htons(port_);   // htons和htonl不能用混！发生过bug！
-
-    struct linger optLinger = {0};
-    if (openLinger_) {
-        // 使用优雅关闭：直到所剩数据发完或超时
-        optLinger.l_onoff = 1;
-        optLinger.l_linger = 1;
-    }
-
-    listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
-    if(listenFd_ < 0) {
-        LOG_ERROR("Create socket error!", port_);
-        return false;
-    }
-
-    // 设置优雅关闭
-    ret = setsockopt(listenFd_, SOL_SOCKET, SO_LINGER,
-                 &optLinger, sizeof(optLinger));
-    if(ret < 0) {
-        close(listenFd_);
-        LOG_ERROR("Init linger error!", port_);
-        return false;
-    }
-
-    int optval = 1;
-    // 允许地址复用(允许绑定到处于 TIME_WAIT 状态的地址)
-    ret = setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR,
-    (const void*)&optval, sizeof(int));
-    if(ret == -1) {
-        LOG_ERROR("set socket setsockopt error !");
-        close(listenFd_);
-        return false;
-    }
-    
-    ret = bind(listenFd_, (sockaddr*)&addr, sizeof(addr));
-    if(ret < 0) {
-        LOG_ERROR("Bind Port:%d error!", port_);
-        close(listenFd_);
-        return false;
+    if (isClose_) {
+        return;
     }
-
-    ret = listen(listenFd_, 6); // TODO,n设置太小？
-    if(ret < 0) {
-        LOG_ERROR("Listen port:%d error!", port_);
-        close(listenFd_);
-        return false;
+    LOG_INFO("========== Server start ==========");
+    // loops_[0] 跑在当前线程，其余每个 loop 独占一个线程
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < loops_.size(); i ++) {
+        threads.emplace_back(&EventLoop::loop, loops_[i].get());
     }
-    //std::cout << "DEBUG: listenEvent_ = " << listenEvent_ << std::endl;
-    ret = epoller_->addFd(listenFd_, listenEvent_ | EPOLLIN);
-    if(ret == 0) {
-        LOG_ERROR("Add listen fd error!");
-        close(listenFd_);
-        return false;
+    loops_[0]->loop();
+    for (auto& t : threads) {
+        t.join();
     }
-    setFdNonBlock(listenFd_);
-    LOG_INFO("Server port:%d", port_);
-    return true;
 }
 
-void WebServer::initEventModel_(int mode) {
+void WebServer::initEventModel_(int mode, bool oneShot) {
     listenEvent_ = EPOLLRDHUP;  // 监听对端关闭
-    connEvent_ = EPOLLONESHOT | EPOLLRDHUP; // ONESHOT 确保一个socket在任一时刻只被一个线程处理
+    connEvent_ = EPOLLRDHUP;
     switch (mode) {
         case 0: break;
         case 1: 
@@ -179,109 +134,11 @@ void WebServer::initEventModel_(int mode) {
             connEvent_ |= EPOLLET;
             break;
     }
-    HttpConn::isET = (connEvent_ & EPOLLET);
-}
-
-void WebServer::dealListen_() {
-    struct sockaddr_in clientAddr;
-    socklen_t addrLen = sizeof(clientAddr);
-    do {
-        int fd = accept(listenFd_, (sockaddr*)&clientAddr, &addrLen);
-        if (fd < 0) return;
-        else if (HttpConn::userCount >= MAX_FD) {
-            sendError_(fd, "Server is busy!");
-            LOG_WARN("Server is full!");
-            return;
-        }
-        addClient_(fd, clientAddr);
-    } while (listenEvent_ & EPOLLET);   // why
-}
-
-void WebServer::dealDisconnect_(HttpConn* client) {
-    assert(client);
-    LOG_INFO("Client[%d] quit!", client->getFd());
-    epoller_->delFd(client->getFd());
-    client->closeConn();
-}
-
-void WebServer::dealRead_(HttpConn* client) {
-    assert(client);
-    extendTime_(client);
-    threadpool_->addTask(std::bind(&WebServer::onRead_, this, client));
-}
-
-void WebServer::dealWrite_(HttpConn* client) {
-    assert(client);
-    extendTime_(client);
-    threadpool_->addTask(std::bind(&WebServer::onWrite_, this, client));
-}
-
-void WebServer::onRead_(HttpConn* client) {
-    assert(client);
-    int ret = -1;
-    int readErrno = 0;
-    ret = client->read(&readErrno);
-    if (ret <= 0 && readErrno != EAGAIN) {
-        dealDisconnect_(client);
-        return;
+    // ONESHOT 确保一个socket在任一时刻只被一个线程处理，每次读写完需 modFd 重新注册。
+    // ET 下改由 EventLoop 的连接所有权状态保证，读写事件一次注册不再重新注册；
+    // LT 若常驻 EPOLLOUT 会持续触发，仍使用 ONESHOT
+    if (oneShot || !(connEvent_ & EPOLLET)) {
+        connEvent_ |= EPOLLONESHOT;
     }
-    onProcess(client);
-
-}
-
-void WebServer::onWrite_(HttpConn* client) {
-    assert(client);
-    int ret = -1;
-    int writeErrno = 0;
-    ret = client->write(&writeErrno);
-    if (client->toWriteBytes() == 0) {
-        if (client->isKeepAlive()) {
-            onProcess(client);
-            return;
-        }
-    }
-    else if (ret < 0) {
-        if (writeErrno == EAGAIN) {
-            epoller_->modFd(client->getFd(), connEvent_ | EPOLLOUT);
-            return;
-        }
-    }
-    dealDisconnect_(client);
-}
-
-void WebServer::onProcess(HttpConn* client) {
-    if (client->process()) {
-        epoller_->modFd(client->getFd(), connEvent_ | EPOLLOUT);
-    }
-    else {
-        epoller_->modFd(client->getFd(), connEvent_ | EPOLLIN);
-    }
-}
-
-void WebServer::addClient_(int fd, struct sockaddr_in clientAddr) {
-    assert(fd > 0);
-    users_[fd].initConn(fd, clientAddr);
-    if (timeoutMs_ > 0) {
-        timer_->add(fd, timeoutMs_,
-            std::bind(&WebServer::dealDisconnect_, this, &users_[fd]));
-    }
-    epoller_->addFd(fd, connEvent_ | EPOLLIN);
-    setFdNonBlock(fd);
-    LOG_INFO("Client[%d] in!", users_[fd].getFd());
-}
-
-void WebServer::sendError_(int fd, const char* message) {
-    assert(fd > 0);
-    int ret = send(fd, message, strlen(message), 0);
-    if(ret < 0) {
-        LOG_WARN("send error to client[%d] error!", fd);
-    }
-    close(fd);
+    HttpConn::isET = (connEvent_ & EPOLLET);
 }
-
-void WebServer::extendTime_(HttpConn* client) {
-    assert(client);
-    if (timeoutMs_ > 0) {
-        timer_->adjust(client->getFd(), timeoutMs_);
-    }
-}
\ No newline at end of file
@@ -1,13 +1,11 @@
 #pragma once
 
-#include <unordered_map>
-#include <unistd.h>
-#include <sys/socket.h>
-#include <netinet/in.h>
+#include <thread>
+#include <signal.h>
+#include <vector>
 
-#include "epoller.h"
+#include "eventloop.h"
 #include "../log/log.h"
-#include "../timer/heaptimer.h"
 #include "../pool/sqlconnpool.h"
 #include "../pool/threadpool.h"
 #include "../pool/sqlconnRAII.h"
@@ -18,47 +16,32 @@ public:
     WebServer(int port, int mode, int timeoutMs, bool optLinger,    // 端口，ET模式，timeoutMs， 优雅退出
         int sqlPort, const char* sqlUser, const char* sqlPwd, const char* dbName,  // Mysql配置
         int connPoolSize, int threadPoolSize,   // 连接池，线程池大小 
-        bool openLog, int logLevel, int logQueueSize); // 日志开关 日志等级 日志异步队列容量
+        bool openLog, int logLevel, int logQueueSize, // 日志开关 日志等级 日志异步队列容量
+        int loopNum = 0,    // 0: 单 Reactor + 线程池, N > 0: N 个 one loop per thread 的 Reactor
+        Poller::BACKEND backend = Poller::EPOLL,    // I/O 多路复用后端
+        bool oneShot = false,   // 连接强制 EPOLLONESHOT，每次读写后重新注册(旧模型，用于对比)
+        long sendfileThreshold = 1024 * 1024,   // 不小于该字节数的文件用 sendfile 发送，< 0 全部走 mmap
+        long contentCacheBytes = 32 * 1024 * 1024,  // 小文件内容缓存的字节预算，<= 0 关闭
+        bool hugePages = false,     // 读缓冲区的块按 2MB 大页分配
+        Log::FORMAT_MODE logFormat = Log::TEXT,     // 日志格式化方式，BINARY 写 .blog 文件
+        Log::OVERFLOW_POLICY logOverflow = Log::DROP_BY_LEVEL,  // 日志环写满时的处理
+        int logSampleN = 10,    // SAMPLE 策略下每 N 行保留 1 行
+        int logFlushMs = Log::FLUSH_INTERVAL_MS,    // 写日志线程最长的收集间隔
+        int logFsyncMs = 0);    // > 0 时至少隔这么久 fdatasync 一次，0 落盘交给内核
     ~WebServer();
 
     void start();
 
-    int setFdNonBlock(int fd);
-
 private:
-    void initEventModel_(int mode);
-
-    bool initSocket_();
-
-    void dealListen_();
-    void dealDisconnect_(HttpConn* client);
-    void dealRead_(HttpConn* client);
-    void dealWrite_(HttpConn* client);
-
-    void onRead_(HttpConn* client);
-    void onWrite_(HttpConn* client);
-    void onProcess(HttpConn* client);
-
-    void addClient_(int fd, struct sockaddr_in clientAddr);
-
-    void sendError_(int fd, const char* message);
-
-    void extendTime_(HttpConn* client);
-
-    static const int MAX_FD = 65536;
+    void initEventModel_(int mode, bool oneShot);
 
     int port_;
-    int timeoutMs_;
-    bool openLinger_;   // socket优雅关闭
     bool isClose_;
-    int listenFd_;
     char* srcDir_;
 
     uint32_t listenEvent_;  // listen fd对应的events
     uint32_t connEvent_;
 
-    std::unique_ptr<HeapTimer> timer_;
-    std::unique_ptr<ThreadPool> threadpool_;
-    std::unique_ptr<Epoller> epoller_;
-    std::unordered_map<int, HttpConn> users_;    // [fd, conn]
-};
\ No newline at end of file
+    std::unique_ptr<ThreadPool> threadpool_;    // 仅单 Reactor 模式使用
+    std::vector<std::unique_ptr<EventLoop>> loops_;
+};
@@ -53,8 +53,9 @@ void HeapTimer::tick() {
         if(std::chrono::duration_cast<MS>(node.expires - Clock::now()).count() > 0) { 
             break; 
         }
-        node.cb();
+        // 先出堆再回调，回调中可以用同一个 id 重新 add
         pop();
+        node.cb();
     }
 }
 
@@ -1,7 +1,10 @@
 #include "../code/buffer/buffer.h"
+#include "../code/buffer/chainbuffer.h"
 #include <iostream>
 #include <assert.h>
 #include <string.h>
+#include <thread>
+#include <chrono>
 
 void TestAppendRetrieve() {
     std::cout << "Testing Append and Retrieve..." << std::endl;
@@ -36,9 +39,126 @@ void TestGrow() {
     std::cout << "Pass!" << std::endl;
 }
 
+void TestChainBuffer() {
+    std::cout << "Testing ChainBuffer..." << std::endl;
+    const size_t BLOCK = BlockPool::BLOCK_SIZE;
+    BlockPool* pool = BlockPool::Instance();
+    {
+        ChainBuffer buff;
+        int fds[2];
+        assert(pipe(fds) == 0);
+        std::string data(BLOCK * 2 + 100, 'x');
+        for (size_t i = 0; i < data.size(); i++) data[i] = 'a' + i % 26;
+        assert(write(fds[1], data.data(), data.size()) == (ssize_t)data.size());
+
+        // readv 直接读进三个块，没用上的块还回池
+        int err = 0;
+        assert(buff.ReadFd(fds[0], &err) == (ssize_t)data.size());
+        assert(buff.ReadableBytes() == data.size() && buff.BlockCount() == 3);
+        assert(pool->TotalBlocks() - pool->FreeBlocks() == 3);
+
+        struct iovec iov[4];
+        assert(buff.ReadIov(iov, 4) == 3 && iov[0].iov_len == BLOCK && iov[2].iov_len == 100);
+
+        // 读完的块立即归还
+        buff.Retrieve(BLOCK + 10);
+        assert(buff.BlockCount() == 2 && buff.ReadableBytes() == BLOCK + 90);
+
+        // 跨块时 Pullup 合并成连续内存
+        std::string_view view = buff.Pullup();
+        assert(buff.BlockCount() == 1 && view == std::string_view(data).substr(BLOCK + 10));
+
+        // 尾块的剩余空间先被填满
+        buff.Append("tail", 4);
+        assert(buff.BlockCount() == 1);
+        assert(buff.RetrieveAllToStr() == data.substr(BLOCK + 10) + "tail");
+        assert(buff.BlockCount() == 0);
+        close(fds[0]);
+        close(fds[1]);
+
+        // 接管 io_uring 填好的块；尾块放得下时拷进去，块交还调用方
+        char* block = pool->Get();
+        memcpy(block, "GET / HTTP/1.1\r\n", 16);
+        assert(buff.AppendBlock(block, 16) == nullptr && buff.BlockCount() == 1);
+        char* next = pool->Get();
+        memcpy(next, "\r\n", 2);
+        assert(buff.AppendBlock(next, 2) == next && buff.BlockCount() == 1);
+        pool->Put(next);
+        assert(buff.Pullup() == "GET / HTTP/1.1\r\n\r\n");
+        buff.RetrieveAll();
+    }
+    assert(pool->TotalBlocks() == pool->FreeBlocks());
+    std::cout << "Pass!" << std::endl;
+}
+
+void TestBlockPoolReclaim() {
+    std::cout << "Testing BlockPool reclaim..." << std::endl;
+    BlockPool* pool = BlockPool::Instance();
+    pool->init(false, 16);
+    std::vector<char*> held;
+    for (int i = 0; i < 200; i++) held.push_back(pool->Get());
+    assert(pool->TotalBlocks() - pool->FreeBlocks() == 200);
+    // 其它线程归还的块在线程退出时回到全局空闲表，超过上限的部分释放
+    std::thread([&] {
+        for (char* block : held) pool->Put(block);
+    }).join();
+    assert(pool->TotalBlocks() == pool->FreeBlocks());
+    assert(pool->TotalBlocks() <= 16 + BlockPool::LOCAL_MAX);
+    pool->init(false, BlockPool::DEFAULT_MAX_FREE);
+
+    // 写缓冲区排空后按高水位缩回
+    Buffer buff;
+    buff.Append(std::string(64 * 1024, 'a'));
+    assert(!buff.Shrink(16 * 1024, 1024));
+    buff.RetrieveAll();
+    assert(buff.Shrink(16 * 1024, 1024) && buff.WritableBytes() == 1024);
+    std::cout << "Pass!" << std::endl;
+}
+
+/*
+一轮 = 追加一行日志大小的数据 + 查询长度 + 取走，与 HttpConn/Log 的用法相同；
+另测一次 RetrieveAll，容量取写缓冲区的高水位 16KB
+*/
+template<class B>
+void BenchOne(const char* name, double* appendNs, double* clearNs) {
+    const int N = 1000000;
+    const std::string line(96, 'x');
+    B buff(16 * 1024);
+    size_t check = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < N; i++) {
+        buff.Append(line);
+        buff.AppendDecimal(i);
+        check += buff.ReadableBytes();
+        buff.Retrieve(buff.ReadableBytes());
+    }
+    auto mid = std::chrono::steady_clock::now();
+    for (int i = 0; i < N; i++) {
+        buff.Append(line);
+        buff.RetrieveAll();
+    }
+    auto end = std::chrono::steady_clock::now();
+    *appendNs = std::chrono::duration<double, std::nano>(mid - start).count() / N;
+    *clearNs = std::chrono::duration<double, std::nano>(end - mid).count() / N;
+    std::cout << "  " << name << *appendNs << " ns/append+retrieve, "
+              << *clearNs << " ns/append+RetrieveAll (check " << check << ")" << std::endl;
+}
+
+void BenchBuffer() {
+    std::cout << "Benchmark: SyncBuffer(atomic) vs Buffer(single owner)" << std::endl;
+    double syncAppend, syncClear, plainAppend, plainClear;
+    BenchOne<SyncBuffer>("SyncBuffer: ", &syncAppend, &syncClear);
+    BenchOne<Buffer>("Buffer:     ", &plainAppend, &plainClear);
+    std::cout << "  speedup:    " << syncAppend / plainAppend << "x / "
+              << syncClear / plainClear << "x" << std::endl;
+}
+
 int main() {
     TestAppendRetrieve();
     TestGrow();
+    TestChainBuffer();
+    TestBlockPoolReclaim();
+    BenchBuffer();
     std::cout << "All Buffer tests passed!" << std::endl;
     return 0;
 }
@@ -0,0 +1,154 @@
+/*
+ * FileCache 模块测试文件
+ * 测试命中、负缓存(及其限额)、inotify 失效以及并发未命中的合并加载，以及 ContentCache 的 LRU 淘汰
+ */
+#include "../code/http/filecache.h"
+#include "../code/http/contentcache.h"
+#include <iostream>
+#include <assert.h>
+#include <fstream>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <stdlib.h>
+#include <unistd.h>
+
+std::string dir;
+
+void WriteFile(const std::string& path, const std::string& content) {
+    std::ofstream(dir + path) << content;
+}
+
+std::string Content(const FileCache::EntryPtr& e) {
+    return e->addr ? std::string(e->addr, e->st.st_size) : "";
+}
+
+// inotify 事件由后台线程异步处理，轮询等待条件成立
+template <typename F>
+bool WaitFor(F cond) {
+    for (int i = 0; i < 100; i++) {
+        if (cond()) { return true; }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    return false;
+}
+
+void TestHitAndInvalidate() {
+    std::cout << "Testing hit and inotify invalidation..." << std::endl;
+    FileCache* cache = FileCache::Instance();
+    WriteFile("/a.html", "v1");
+
+    auto e1 = cache->get("/a.html");
+    assert(e1->err == 0 && Content(e1) == "v1");
+    auto e2 = cache->get("/a.html");
+    assert(e1 == e2);   // 第二次命中同一个条目
+    assert(cache->hits() == 1);
+
+    WriteFile("/a.html", "version2");
+    assert(WaitFor([&]() { return Content(cache->get("/a.html")) == "version2"; }));
+    assert(e1->st.st_size == 2);    // 旧引用仍然可用，直到最后一个持有者释放
+    std::cout << "Pass!" << std::endl;
+}
+
+void TestNegativeAndSubdir() {
+    std::cout << "Testing negative entries and new subdirectories..." << std::endl;
+    FileCache* cache = FileCache::Instance();
+    assert(cache->get("/sub/b.css")->err == ENOENT);
+    assert(cache->get("/sub/b.css")->err == ENOENT);
+
+    mkdir((dir + "/sub").c_str(), 0755);
+    WriteFile("/sub/b.css", "body{}");
+    assert(WaitFor([&]() { return cache->get("/sub/b.css")->err == 0; }));
+
+    // 新目录也被监听
+    auto e = cache->get("/sub/b.css");
+    WriteFile("/sub/b.css", "body{color:red}");
+    assert(WaitFor([&]() { return Content(cache->get("/sub/b.css")) == "body{color:red}"; }));
+    std::cout << "Pass!" << std::endl;
+}
+
+void TestCoalesce() {
+    std::cout << "Testing concurrent miss coalescing..." << std::endl;
+    FileCache* cache = FileCache::Instance();
+    WriteFile("/cold.html", std::string(1 << 20, 'x'));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));    // 等写入产生的事件处理完
+
+    uint64_t loads = cache->loads();
+    std::vector<std::thread> threads;
+    std::vector<FileCache::EntryPtr> results(8);
+    for (int i = 0; i < 8; i++) {
+        threads.emplace_back([&, i]() { results[i] = cache->get("/cold.html"); });
+    }
+    for (auto& t : threads) { t.join(); }
+    for (auto& r : results) {
+        assert(r == results[0] && r->st.st_size == (1 << 20));
+    }
+    assert(cache->loads() - loads == 1);
+    std::cout << "Pass!" << std::endl;
+}
+
+// 大量不存在的路径不会把正常条目挤出缓存
+void TestNegativeLimit() {
+    std::cout << "Testing negative entry limit..." << std::endl;
+    FileCache* cache = FileCache::Instance();
+    FileCache::EntryPtr hot = cache->get("/a.html");
+    for (size_t i = 0; i < FileCache::MAX_ENTRIES + 100; i++) {
+        assert(cache->get("/scan-" + std::to_string(i) + ".php")->err == ENOENT);
+    }
+    assert(cache->get("/a.html") == hot);
+    uint64_t loads = cache->loads();
+    cache->get("/scan-0.php");          // 在限额内，仍是负缓存
+    assert(cache->loads() == loads);
+    cache->get("/scan-2000.php");       // 超出限额，每次都重新 stat
+    assert(cache->loads() == loads + 1);
+    std::cout << "Pass!" << std::endl;
+}
+
+void TestContentCacheLru() {
+    std::cout << "Testing ContentCache LRU..." << std::endl;
+    ContentCache* cache = ContentCache::Instance();
+    FileCache::EntryPtr source = FileCache::Instance()->get("/a.html");
+    auto make = [&](size_t n) {
+        ContentCache::Blob blob;
+        blob.source = source;
+        blob.body.assign(n, 'x');
+        return blob;
+    };
+    size_t unit = make(1000).size();
+    cache->init(unit * 2);
+    cache->put("/1", make(1000));
+    cache->put("/2", make(1000));
+    assert(cache->get("/1", source, 200));  // 访问后 /1 变为最近使用
+    cache->put("/3", make(1000));           // 超出预算，淘汰 /2
+    assert(cache->evictions() == 1 && cache->count() == 2 && cache->bytes() == unit * 2);
+    assert(!cache->get("/2", source, 200));
+    assert(cache->get("/3", source, 200));
+    assert(!cache->get("/3", source, 404));     // 状态码不同视为未命中
+    assert(!cache->get("/3", nullptr, 200));    // 文件条目已变化视为未命中
+
+    ContentCache::BlobPtr big = cache->put("/big", make(5000));
+    assert(big && big->body.size() == 5000 && !cache->get("/big", source, 200));    // 超过预算只返回不缓存
+    assert(cache->hits() == 2 && cache->count() == 2);
+
+    std::string body;
+    assert(ContentCache::readFile(*source, body) && body == Content(source));
+    cache->init(0);
+    std::cout << "Pass!" << std::endl;
+}
+
+int main() {
+    char tmpl[] = "/tmp/filecache_XXXXXX";
+    dir = mkdtemp(tmpl);
+    FileCache::Instance()->init(dir);
+
+    TestHitAndInvalidate();
+    TestNegativeAndSubdir();
+    TestCoalesce();
+    TestNegativeLimit();
+    TestContentCacheLru();
+
+    FileCache::Instance()->close();
+    system(("rm -rf " + dir).c_str());
+    std::cout << "All FileCache tests passed!" << std::endl;
+    return 0;
+}
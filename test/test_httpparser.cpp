@@ -0,0 +1,333 @@
+/*
+ * HttpParser 模块测试文件
+ * 测试完整/分段/非法请求的解析，并与原先基于 std::regex 的实现做性能对比；
+ * 对比 SIMD 扫描内核(scalar / sse4.2 / avx2)在大头部与大表单上的性能
+ */
+#include "../code/http/httpparser.h"
+#include "../code/http/httpscan.h"
+#include "../code/buffer/buffer.h"
+#include <iostream>
+#include <assert.h>
+#include <string>
+#include <regex>
+#include <unordered_map>
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+const std::string GET_REQ =
+    "GET /index.html HTTP/1.1\r\n"
+    "Host: 127.0.0.1:8080\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 Chrome/120.0\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+    "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Connection: keep-alive\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "\r\n";
+
+const std::string POST_REQ =
+    "POST /login HTTP/1.1\r\n"
+    "Host: 127.0.0.1:8080\r\n"
+    "Content-Type: application/x-www-form-urlencoded\r\n"
+    "Content-Length: 27\r\n"
+    "\r\n"
+    "username=abc&password=12345";
+
+// 原 HttpRequest 的解析逻辑：逐行拷贝成 string，每行现场构造 regex
+struct LegacyParser {
+    std::string method_, path_, version_, body_;
+    std::unordered_map<std::string, std::string> header_;
+    int state_ = 0;  // 0: 请求行, 1: 头部, 2: body, 3: 完成
+
+    bool parse(Buffer& buffer) {
+        const char CRLF[] = "\r\n";
+        while (buffer.ReadableBytes() && state_ != 3) {
+            const char* lineEnd = std::search(buffer.ReadPtr(),
+                        buffer.WritePtrConst(), CRLF, CRLF + 2);
+            std::string line(buffer.ReadPtr(), lineEnd);
+            if (state_ == 0) {
+                std::regex patten("^([^ ]*) ([^ ]*) HTTP/([^ ]*)$");
+                std::smatch subMatch;
+                if (!std::regex_match(line, subMatch, patten)) { return false; }
+                method_ = subMatch[1];
+                path_ = subMatch[2];
+                version_ = subMatch[3];
+                state_ = 1;
+            }
+            else if (state_ == 1) {
+                std::regex patten("^([^:]*): ?(.*)$");
+                std::smatch subMatch;
+                if (std::regex_match(line, subMatch, patten)) {
+                    header_[subMatch[1]] = subMatch[2];
+                }
+                else { state_ = 2; }
+                if (buffer.ReadableBytes() <= 2) { state_ = 3; }
+            }
+            else {
+                body_ = line;
+                state_ = 3;
+            }
+            if (lineEnd == buffer.WritePtr()) { break; }
+            buffer.RetrieveUntil(lineEnd + 2);
+        }
+        return true;
+    }
+};
+
+void TestGet() {
+    std::cout << "Testing GET..." << std::endl;
+    HttpParser parser;
+    assert(parser.parse(GET_REQ.data(), GET_REQ.size()) == HttpParser::COMPLETE);
+    assert(parser.consumed() == GET_REQ.size());
+    assert(parser.method() == "GET");
+    assert(parser.path() == "/index.html");
+    assert(parser.version() == "1.1");
+    assert(parser.headerCount() == 7);
+    assert(parser.header("host") == "127.0.0.1:8080");
+    assert(parser.header("CONNECTION") == "keep-alive");
+    assert(parser.header("X-None").empty());
+    assert(parser.body().empty());
+    std::cout << "Pass!" << std::endl;
+}
+
+void TestPostAndPipeline() {
+    std::cout << "Testing POST body and pipelined requests..." << std::endl;
+    std::string data = POST_REQ + GET_REQ;
+    HttpParser parser;
+    assert(parser.parse(data.data(), data.size()) == HttpParser::COMPLETE);
+    assert(parser.consumed() == POST_REQ.size());
+    assert(parser.contentLength() == 27);
+    assert(parser.body() == "username=abc&password=12345");
+
+    parser.reset();
+    const char* next = data.data() + POST_REQ.size();
+    assert(parser.parse(next, GET_REQ.size()) == HttpParser::COMPLETE);
+    assert(parser.path() == "/index.html");
+    std::cout << "Pass!" << std::endl;
+}
+
+void TestIncremental() {
+    std::cout << "Testing byte-by-byte resume..." << std::endl;
+    // 每次多给一个字节，且每次换一块内存，模拟缓冲区扩容搬移
+    HttpParser parser;
+    for (size_t n = 1; n <= POST_REQ.size(); n++) {
+        std::string copy = POST_REQ.substr(0, n);
+        HttpParser::STATUS st = parser.parse(copy.data(), copy.size());
+        assert(st == (n == POST_REQ.size() ? HttpParser::COMPLETE : HttpParser::INCOMPLETE));
+        if (st == HttpParser::COMPLETE) {
+            assert(parser.method() == "POST");
+            assert(parser.header("Content-Type") == "application/x-www-form-urlencoded");
+            assert(parser.body() == "username=abc&password=12345");
+        }
+    }
+    std::cout << "Pass!" << std::endl;
+}
+
+void TestMalformed() {
+    std::cout << "Testing malformed requests..." << std::endl;
+    const char* bad[] = {
+        "GET /index.html\r\n\r\n",                          // 缺少版本
+        "GET  /index.html HTTP/1.1\r\n\r\n",                // 多余空格
+        "G(T / HTTP/1.1\r\n\r\n",                           // 方法含非法字符
+        "GET / HTTP/1.1x\r\n\r\n",                          // 版本格式错误
+        "GET / HTTP/1.1\n\r\n",                             // 缺少 CR
+        "GET / HTTP/1.1\r\nHost 127.0.0.1\r\n\r\n",         // 头部缺少 ':'
+        "GET / HTTP/1.1\r\n folded\r\n\r\n",                // 折行
+        "GET / HTTP/1.1\r\nContent-Length: 1x\r\n\r\n",
+        "GET / HTTP/1.1\r\nContent-Length: 1\r\nContent-Length: 2\r\n\r\n",
+        "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n",
+    };
+    for (const char* req : bad) {
+        HttpParser parser;
+        assert(parser.parse(req, strlen(req)) == HttpParser::ERROR);
+    }
+
+    // 头部超过上限
+    std::string big = "GET / HTTP/1.1\r\nX: " + std::string(HttpParser::MAX_HEAD_SIZE, 'a');
+    HttpParser parser;
+    assert(parser.parse(big.data(), big.size()) == HttpParser::ERROR);
+    std::cout << "Pass!" << std::endl;
+}
+
+void TestScanKernels() {
+    std::cout << "Testing scan kernels agree with scalar..." << std::endl;
+    std::mt19937 rng(42);
+    const char* alphabet = "abc:&=%+ \t\r\n\x01\x7f\x80";
+    for (int round = 0; round < 2000; round++) {
+        std::string s(rng() % 100, 'x');
+        for (char& c : s) {
+            if (rng() % 8 == 0) { c = alphabet[rng() % 15]; }
+        }
+        const char* b = s.data();
+        const char* e = b + s.size();
+        HttpScan::setKernel(HttpScan::SCALAR);
+        const char* chars = HttpScan::findChars(b, e, "&=%+", 4);
+        const char* ctl = HttpScan::findCtl(b, e);
+        const char* sp = HttpScan::findSpaceOrCtl(b, e);
+        for (HttpScan::KERNEL k : {HttpScan::SSE42, HttpScan::AVX2}) {
+            if (!HttpScan::setKernel(k)) { continue; }
+            assert(HttpScan::findChars(b, e, "&=%+", 4) == chars);
+            assert(HttpScan::findCtl(b, e) == ctl);
+            assert(HttpScan::findSpaceOrCtl(b, e) == sp);
+        }
+    }
+    std::cout << "Pass!" << std::endl;
+}
+
+void TestUrlencoded() {
+    std::cout << "Testing urlencoded form decoding..." << std::endl;
+    std::unordered_map<std::string, std::string> post;
+    HttpParser::parseUrlencoded("username=a+b%21%e4%B8%AD&password=1%2&x=&=y&tail=1=2", post);
+    assert(post["username"] == "a b!\xe4\xb8\xad");
+    assert(post["password"] == "1%2");
+    assert(post["x"] == "");
+    assert(post["tail"] == "1=2");
+    assert(post.count("") == 0);
+    std::cout << "Pass!" << std::endl;
+}
+
+void TestNormalizePath() {
+    std::cout << "Testing path normalization..." << std::endl;
+    auto norm = [](std::string path) {
+        HttpParser::normalizePath(path);
+        return path;
+    };
+    assert(norm("/index.html") == "/index.html");
+    assert(norm("//index.html") == "/index.html");
+    assert(norm("/./index.html") == "/index.html");
+    assert(norm("/a//b.html") == "/a/b.html");
+    assert(norm("/a/.//./b.html") == "/a/b.html");
+    assert(norm("/a/.") == "/a/");
+    assert(norm("//") == "/");
+    assert(norm("/.hidden/..x") == "/.hidden/..x");
+    assert(norm("/a/./../b") == "/a/../b");     // ".." 留给调用方拒绝
+    std::cout << "Pass!" << std::endl;
+}
+
+void BenchParse() {
+    std::cout << "Benchmark: legacy regex vs HttpParser (GET, 7 headers)" << std::endl;
+    const int N = 20000;
+    Buffer buff;
+
+    auto start = std::chrono::steady_clock::now();
+    size_t check = 0;
+    for (int i = 0; i < N; i++) {
+        buff.Append(GET_REQ);
+        LegacyParser legacy;
+        legacy.parse(buff);
+        check += legacy.header_.size();
+        buff.RetrieveAll();
+    }
+    auto mid = std::chrono::steady_clock::now();
+    for (int i = 0; i < N; i++) {
+        buff.Append(GET_REQ);
+        HttpParser parser;
+        parser.parse(buff.ReadPtr(), buff.ReadableBytes());
+        check += parser.header("Connection").size();
+        buff.Retrieve(parser.consumed());
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double legacyNs = std::chrono::duration<double, std::nano>(mid - start).count() / N;
+    double newNs = std::chrono::duration<double, std::nano>(end - mid).count() / N;
+    std::cout << "  legacy:     " << legacyNs << " ns/req" << std::endl;
+    std::cout << "  HttpParser: " << newNs << " ns/req" << std::endl;
+    std::cout << "  speedup:    " << legacyNs / newNs << "x (check " << check << ")" << std::endl;
+}
+
+// 原 parseFromUrlencoded_ 的逐字节 switch，只统计分隔符个数
+size_t LegacyFormScan(const std::string& body) {
+    size_t n = 0;
+    for (size_t i = 0; i < body.size(); i++) {
+        switch (body[i]) {
+            case '=': case '+': case '%': case '&': n++; break;
+            default: break;
+        }
+    }
+    return n;
+}
+
+// 原 HttpRequest::parse 找行尾的方式
+size_t LegacyLineScan(const std::string& head) {
+    const char CRLF[] = "\r\n";
+    size_t n = 0;
+    const char* p = head.data();
+    const char* end = p + head.size();
+    while ((p = std::search(p, end, CRLF, CRLF + 2)) != end) { p += 2; n++; }
+    return n;
+}
+
+size_t KernelFormScan(const std::string& body) {
+    size_t n = 0;
+    const char* p = body.data();
+    const char* end = p + body.size();
+    while ((p = HttpScan::findChars(p, end, "&=%+", 4)) != end) { p++; n++; }
+    return n;
+}
+
+size_t KernelLineScan(const std::string& head) {
+    size_t n = 0;
+    const char* p = head.data();
+    const char* end = p + head.size();
+    while ((p = HttpScan::findCtl(p, end)) != end) { p += 2; n++; }
+    return n;
+}
+
+template <typename F>
+double TimeNs(int n, F f) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i++) { f(); }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / n;
+}
+
+void BenchKernels() {
+    // 大头部：20 个长头部 + 4KB Cookie
+    std::string head = "GET /index.html HTTP/1.1\r\n";
+    for (int i = 0; i < 20; i++) {
+        head += "X-Header-" + std::to_string(i) + ": " + std::string(400, 'v') + "\r\n";
+    }
+    head += "Cookie: " + std::string(4096, 'c') + "\r\n\r\n";
+
+    // 大表单：64KB，字段值较长
+    std::string form;
+    for (int i = 0; form.size() < 64 * 1024; i++) {
+        form += "field" + std::to_string(i) + "=" + std::string(600, 'd') + "%21" + std::string(400, 'e') + "&";
+    }
+
+    std::cout << "Benchmark: scan kernels (head " << head.size() << "B, form "
+              << form.size() << "B)" << std::endl;
+    std::cout << "  legacy: line scan " << TimeNs(2000, [&]() { LegacyLineScan(head); })
+              << " ns, form scan " << TimeNs(200, [&]() { LegacyFormScan(form); }) << " ns" << std::endl;
+    for (HttpScan::KERNEL k : {HttpScan::SCALAR, HttpScan::SSE42, HttpScan::AVX2}) {
+        if (!HttpScan::setKernel(k)) { continue; }
+        double lineNs = TimeNs(2000, [&]() { KernelLineScan(head); });
+        double formScanNs = TimeNs(200, [&]() { KernelFormScan(form); });
+        double headNs = TimeNs(2000, [&]() {
+            HttpParser parser;
+            assert(parser.parse(head.data(), head.size()) == HttpParser::COMPLETE);
+        });
+        double formNs = TimeNs(200, [&]() {
+            std::unordered_map<std::string, std::string> post;
+            HttpParser::parseUrlencoded(form, post);
+        });
+        std::cout << "  " << HttpScan::kernelName(k) << ": line scan " << lineNs
+                  << " ns, form scan " << formScanNs << " ns | parse head " << headNs
+                  << " ns, decode form " << formNs << " ns" << std::endl;
+    }
+}
+
+int main() {
+    TestGet();
+    TestPostAndPipeline();
+    TestIncremental();
+    TestMalformed();
+    TestScanKernels();
+    TestUrlencoded();
+    TestNormalizePath();
+    BenchParse();
+    BenchKernels();
+    std::cout << "All HttpParser tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,481 @@
+/*
+ * HttpResponse 模块测试文件
+ * 测试响应头格式(状态行、Date、Content-type、Content-length)、条件请求(304)、Range(206/416)、gzip 变体、预加载的错误页面、
+ * 不规范路径在文件修改后的失效，
+ * 并统计缓存命中后生成一个 200 响应的堆分配次数
+ */
+#include "../code/http/httpresponse.h"
+#include <iostream>
+#include <assert.h>
+#include <fstream>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <thread>
+#include <zlib.h>
+
+static std::atomic<long> allocs(0);
+
+void* operator new(size_t size) {
+    allocs++;
+    if (void* p = malloc(size)) { return p; }
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+std::string dir;
+
+std::string Head(HttpResponse& response, Buffer& buffer) {
+    return std::string(response.head()) + buffer.RetrieveAllToStr();
+}
+
+void TestAppendDecimal() {
+    std::cout << "Testing Buffer::AppendDecimal..." << std::endl;
+    Buffer buffer;
+    for (uint64_t n : {0ULL, 7ULL, 10ULL, 99ULL, 100ULL, 12345ULL, 18446744073709551615ULL}) {
+        buffer.AppendDecimal(n);
+        assert(buffer.RetrieveAllToStr() == std::to_string(n));
+    }
+    std::cout << "Pass!" << std::endl;
+}
+
+void TestHeaders() {
+    std::cout << "Testing response headers..." << std::endl;
+    Buffer buffer;
+    HttpResponse response;
+    std::string path = "/index.html";
+    response.init(dir, path, true, 200);
+    response.makeResponse(buffer);
+    std::string head = Head(response, buffer);
+    assert(head.find("HTTP/1.1 200 OK\r\n") == 0);
+    assert(head.find("\r\nDate: ") != std::string::npos && head.find(" GMT\r\n") != std::string::npos);
+    assert(head.find("Connection: keep-alive\r\n") != std::string::npos);
+    assert(head.find("Content-type: text/html\r\n") != std::string::npos);
+    assert(head.find("Content-length: 5\r\n") != std::string::npos);
+    assert(response.body() == "hello");
+
+    path = "/style.css";
+    response.init(dir, path, false, 200);
+    response.makeResponse(buffer);
+    head = Head(response, buffer);
+    assert(head.find("Content-type: text/css\r\n") != std::string::npos);
+    assert(head.find("Content-length: 100000\r\n\r\n") != std::string::npos);
+    assert(head.find("Connection: close\r\n") != std::string::npos);
+    assert(response.bodyLen() == 100000);
+
+    path = "/nope.html";
+    response.init(dir, path, false, 200);
+    response.makeResponse(buffer);
+    assert(Head(response, buffer).find("HTTP/1.1 404 Not Found\r\n") == 0);
+    response.closeFile();
+    std::cout << "Pass!" << std::endl;
+}
+
+std::string Header(const std::string& head, const std::string& key) {
+    size_t pos = head.find("\r\n" + key + ": ");
+    if (pos == std::string::npos) { return ""; }
+    pos += key.size() + 4;
+    return head.substr(pos, head.find("\r\n", pos) - pos);
+}
+
+void TestConditional() {
+    std::cout << "Testing conditional GET..." << std::endl;
+    Buffer buffer;
+    HttpResponse response;
+    std::string path = "/style.css";
+    auto get = [&](std::string_view inm, std::string_view ims) {
+        response.init(dir, path, true, 200);
+        response.setConditions(inm, ims);
+        response.makeResponse(buffer);
+        return Head(response, buffer);
+    };
+    std::string head = get("", "");
+    std::string etag = Header(head, "ETag"), lastModified = Header(head, "Last-Modified");
+    assert(etag.size() > 2 && etag.front() == '"' && !lastModified.empty());
+    assert(Header(head, "Cache-Control") == "max-age=86400");
+
+    head = get(etag, "");
+    assert(head.find("HTTP/1.1 304 Not Modified\r\n") == 0);
+    assert(Header(head, "ETag") == etag && Header(head, "Content-length").empty());
+    assert(response.bodyLen() == 0 && response.bodyFd() < 0);
+    assert(get("\"x\", W/" + etag, "").find("HTTP/1.1 304") == 0);
+    assert(get("*", "").find("HTTP/1.1 304") == 0);
+    assert(get("\"x\"", lastModified).find("HTTP/1.1 200") == 0);    // If-None-Match 优先
+    assert(get("", lastModified).find("HTTP/1.1 304") == 0);
+    assert(get("", "Fri, 01 Jan 2100 00:00:00 GMT").find("HTTP/1.1 304") == 0);
+    assert(get("", "Thu, 01 Jan 1970 00:00:00 GMT").find("HTTP/1.1 200") == 0);
+    assert(get("", "garbage").find("HTTP/1.1 200") == 0);
+
+    path = "/index.html";   // ContentCache 的 Blob 同样带校验值
+    head = get("", "");
+    assert(Header(head, "Cache-Control") == "no-cache" && !Header(head, "ETag").empty());
+    assert(get(Header(head, "ETag"), "").find("HTTP/1.1 304") == 0);
+    path = "/nope.html";    // 错误页面不带校验值，也不会 304
+    head = get("*", "");
+    assert(head.find("HTTP/1.1 404") == 0 && Header(head, "ETag").empty());
+    response.closeFile();
+    std::cout << "Pass!" << std::endl;
+}
+
+// 按 HttpConn 的顺序拼出完整响应：预生成头，各段的 buffer 字节与正文，结尾分隔符
+std::string Assemble(HttpResponse& response, Buffer& buffer) {
+    std::string out(response.head());
+    for (const HttpResponse::Part& part : response.parts()) {
+        out.append(buffer.ReadPtr(), part.headLen);
+        buffer.Retrieve(part.headLen);
+        if (response.bodyFd() >= 0) {
+            std::string data(part.len, '\0');
+            assert(pread(response.bodyFd(), &data[0], part.len, part.off) == (ssize_t)part.len);
+            out += data;
+        }
+        else {
+            out.append(response.body().data() + part.off, part.len);
+        }
+    }
+    out.append(buffer.ReadPtr(), response.tailLen());
+    buffer.Retrieve(response.tailLen());
+    assert(buffer.ReadableBytes() == 0);
+    return out;
+}
+
+void TestRange() {
+    std::cout << "Testing byte ranges..." << std::endl;
+    Buffer buffer;
+    HttpResponse response;
+    std::string content;
+    for (int i = 0; i < 2000; i++) { content += std::to_string(i % 10); }
+    std::ofstream(dir + "/clip.mp4") << content;
+    std::string paths[] = {"/clip.mp4", "/style.css"};     // ContentCache 的小文件与映射的大文件
+    std::string path;
+    auto get = [&](std::string_view range, std::string_view ifRange = "") {
+        response.init(dir, path, true, 200);
+        response.setRange(range, ifRange);
+        response.makeResponse(buffer);
+        return Assemble(response, buffer);
+    };
+    auto body = [](const std::string& out) { return out.substr(out.find("\r\n\r\n") + 4); };
+    for (std::string& p : paths) {
+        path = p;
+        std::string full = body(get(""));
+        size_t size = full.size();
+
+        std::string out = get("bytes=10-19");
+        assert(out.find("HTTP/1.1 206 Partial Content\r\n") == 0);
+        assert(Header(out, "Content-Range") == "bytes 10-19/" + std::to_string(size));
+        assert(Header(out, "Content-length") == "10" && body(out) == full.substr(10, 10));
+        assert(body(get("bytes=-5")) == full.substr(size - 5));
+        assert(body(get("bytes=1990-")) == full.substr(1990));
+        assert(body(get("bytes=5-999999")) == full.substr(5));
+        assert(get("bytes=" + std::to_string(size) + "-").find("HTTP/1.1 416") == 0);
+        assert(Header(get("bytes=99999999-"), "Content-Range") == "bytes */" + std::to_string(size));
+        // 语法错误、If-Range 不符时忽略 Range，回完整文件
+        assert(get("bytes=5-1").find("HTTP/1.1 200") == 0);
+        assert(get("items=0-1").find("HTTP/1.1 200") == 0);
+        assert(body(get("bytes=0-1", "\"stale\"")) == full);
+        std::string etag = Header(get(""), "ETag");
+        assert(body(get("bytes=0-1", etag)) == full.substr(0, 2));
+
+        out = get("bytes=0-2, 100-104,-3");
+        assert(Header(out, "Content-type") == "multipart/byteranges; boundary=WebServerFromZeroByteRanges");
+        std::string parts = body(out);
+        assert(std::to_string(parts.size()) == Header(out, "Content-length"));
+        size_t pos = 0;
+        std::pair<size_t, size_t> expect[] = {{0, 3}, {100, 5}, {size - 3, 3}};
+        for (auto& r : expect) {
+            pos = parts.find("--WebServerFromZeroByteRanges\r\n", pos);
+            assert(pos != std::string::npos);
+            std::string range = "bytes " + std::to_string(r.first) + "-" +
+                    std::to_string(r.first + r.second - 1) + "/" + std::to_string(size);
+            assert(Header(parts.substr(pos), "Content-Range") == range);
+            pos = parts.find("\r\n\r\n", pos) + 4;
+            assert(parts.substr(pos, r.second) == full.substr(r.first, r.second));
+        }
+        assert(parts.substr(parts.size() - 35) == "\r\n--WebServerFromZeroByteRanges--\r\n");
+    }
+    response.closeFile();
+    std::cout << "Pass!" << std::endl;
+}
+
+std::string Gunzip(const std::string& in) {
+    z_stream zs = {};
+    assert(inflateInit2(&zs, 15 + 16) == Z_OK);
+    std::string out(in.size() * 20 + 1024, '\0');
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+    zs.avail_in = in.size();
+    zs.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    zs.avail_out = out.size();
+    assert(inflate(&zs, Z_FINISH) == Z_STREAM_END);
+    out.resize(zs.total_out);
+    inflateEnd(&zs);
+    return out;
+}
+
+void TestGzip() {
+    std::cout << "Testing gzip variants..." << std::endl;
+    Buffer buffer;
+    HttpResponse response;
+    std::string css, js;
+    for (int i = 0; i < 300; i++) { css += ".c" + std::to_string(i) + " { color: red; }\n"; }
+    for (int i = 0; i < 300; i++) { js += "var v" + std::to_string(i) + " = " + std::to_string(i) + ";\n"; }
+    std::ofstream(dir + "/site.css") << css;
+    std::ofstream(dir + "/app.js") << js;
+    std::string gz;
+    assert(Compressor::gzip(js, gz));
+    std::ofstream(dir + "/app.js.gz") << gz;     // 预压缩的兄弟文件
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));    // 等写入产生的 inotify 事件处理完
+
+    std::string path;
+    auto get = [&](bool gzip, std::string_view inm = "", std::string_view range = "") {
+        response.init(dir, path, true, 200);
+        response.setConditions(inm, "");
+        response.setRange(range, "");
+        response.setAcceptGzip(gzip);
+        response.makeResponse(buffer);
+        return Assemble(response, buffer);
+    };
+    auto body = [](const std::string& out) { return out.substr(out.find("\r\n\r\n") + 4); };
+
+    // 没有 .gz 文件：第一次发送原文，后台压缩完成后发送缓存的压缩结果
+    path = "/site.css";
+    uint64_t jobs = Compressor::Instance()->jobs();
+    std::string out = get(true);
+    assert(Header(out, "Content-Encoding").empty() && body(out) == css);
+    assert(Header(out, "Vary") == "Accept-Encoding");
+    for (int i = 0; i < 100 && Compressor::Instance()->jobs() == jobs; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    out = get(true);
+    assert(Header(out, "Content-Encoding") == "gzip" && Header(out, "Vary") == "Accept-Encoding");
+    assert(Gunzip(body(out)) == css && body(out).size() < css.size() / 4);
+    std::string etag = Header(out, "ETag");
+    assert(etag.size() > 6 && etag.substr(etag.size() - 6) == "-gzip\"");
+    assert(get(true, etag).find("HTTP/1.1 304") == 0 && Header(get(true, etag), "ETag") == etag);
+    // 只按 If-Modified-Since 得到的 304 不知道客户端缓存的是哪个变体，回原 ETag
+    std::string lastModified = Header(out, "Last-Modified");
+    response.init(dir, path, true, 200);
+    response.setConditions("", lastModified);
+    response.setAcceptGzip(true);
+    response.makeResponse(buffer);
+    out = Assemble(response, buffer);
+    assert(out.find("HTTP/1.1 304") == 0 && Header(out, "ETag") != etag);
+    assert(Header(out, "ETag").find("-gzip") == std::string::npos);
+    assert(body(get(false)) == css);    // 不接受 gzip
+    assert(body(get(true, "", "bytes=0-9")) == css.substr(0, 10));   // Range 发送原文的区间
+    assert(Compressor::Instance()->jobs() == jobs + 1);
+
+    // 有 .gz 文件：第一次就发送它
+    path = "/app.js";
+    out = get(true);
+    assert(Header(out, "Content-Encoding") == "gzip" && body(out) == gz);
+
+    // 压缩后仍不小于 MAX_OBJECT 的结果不缓存，只留一个空 Blob，之后发送原文也不再提交
+    std::string noisy;
+    unsigned seed = 1;
+    while (noisy.size() < 4 * ContentCache::MAX_OBJECT) {
+        seed = seed * 1103515245 + 12345;
+        noisy += "0123456789abcdef"[(seed >> 16) & 15];
+    }
+    std::ofstream(dir + "/noisy.txt") << noisy;
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    path = "/noisy.txt";
+    jobs = Compressor::Instance()->jobs();
+    size_t cached = ContentCache::Instance()->bytes();
+    assert(Header(get(true), "Content-Encoding").empty());
+    for (int i = 0; i < 100 && Compressor::Instance()->jobs() == jobs; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    out = get(true);
+    assert(Header(out, "Content-Encoding").empty() && body(out) == noisy);
+    assert(Compressor::Instance()->jobs() == jobs + 1);
+    assert(ContentCache::Instance()->bytes() < cached + 1024);
+
+    // 同样大的 .gz 兄弟文件不读入 ContentCache，像普通文件一样从映射发送
+    std::string noisyGz;
+    assert(Compressor::gzip(noisy, noisyGz) && !ContentCache::cacheable(noisyGz.size()));
+    std::ofstream(dir + "/noisy.txt.gz") << noisyGz;
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    cached = ContentCache::Instance()->bytes();
+    out = get(true);
+    assert(Header(out, "Content-Encoding") == "gzip" && body(out) == noisyGz);
+    assert(Header(out, "Content-length") == std::to_string(noisyGz.size()));
+    assert(Header(out, "ETag").find("-gzip") != std::string::npos);
+    assert(response.head().empty() && !response.body().empty());
+    assert(ContentCache::Instance()->bytes() == cached);
+
+    // 不在允许列表中的类型不压缩
+    path = "/clip.mp4";
+    assert(Header(get(true), "Content-Encoding").empty());
+    response.closeFile();
+    std::cout << "Pass!" << std::endl;
+}
+
+void TestErrorPages() {
+    std::cout << "Testing preloaded error pages..." << std::endl;
+    HttpResponse::loadErrorPages();
+    Buffer buffer;
+    HttpResponse response;
+    std::string path = "/random-1.php";
+    response.init(dir, path, false, 200);
+    response.makeResponse(buffer);
+    std::string out = Assemble(response, buffer);
+    assert(out.find("HTTP/1.1 404 Not Found\r\n") == 0 && Header(out, "Content-type") == "text/html");
+    assert(out.substr(out.size() - 9) == "not found" && Header(out, "Content-length") == "9");
+
+    path = "/400.html";     // 400.html 不存在，使用生成的页面，也不查找文件
+    uint64_t loads = FileCache::Instance()->loads();
+    response.init(dir, path, false, 400);
+    response.makeResponse(buffer);
+    out = Assemble(response, buffer);
+    assert(out.find("HTTP/1.1 400 Bad Request\r\n") == 0 && out.find("400 : Bad Request") != std::string::npos);
+    assert(FileCache::Instance()->loads() == loads);
+
+    // 同一路径反复 404：只查一次文件缓存，不分配内存
+    path = "/random-1.php";
+    long before = allocs;
+    for (int i = 0; i < 1000; i++) {
+        response.init(dir, path, true, 200);
+        response.makeResponse(buffer);
+        buffer.RetrieveAll();
+    }
+    assert(allocs == before && FileCache::Instance()->loads() == loads);
+    response.closeFile();
+    std::cout << "Pass!" << std::endl;
+}
+
+// 不规范的路径规范化后与 inotify 失效用的是同一个缓存键，文件修改后不会返回旧内容
+void TestNonCanonicalPath() {
+    std::cout << "Testing non-canonical paths after an edit..." << std::endl;
+    Buffer buffer;
+    HttpResponse response;
+    std::ofstream(dir + "/a/page.html") << "v1";
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    const char* raws[] = {"//a/page.html", "/./a/page.html", "/a//page.html", "/a/./page.html"};
+    auto get = [&](const char* raw) {
+        std::string path = raw;
+        HttpParser::normalizePath(path);
+        response.init(dir, path, true, 200);
+        response.makeResponse(buffer);
+        return Assemble(response, buffer);
+    };
+    for (const char* raw : raws) {
+        std::string out = get(raw);
+        assert(out.substr(out.size() - 2) == "v1");
+    }
+    std::string etag = Header(get(raws[0]), "ETag");
+
+    std::ofstream(dir + "/a/page.html") << "version2";
+    bool changed = false;
+    for (int i = 0; i < 100 && !changed; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        changed = Header(get("/a/page.html"), "ETag") != etag;
+    }
+    assert(changed);
+    for (const char* raw : raws) {
+        std::string out = get(raw);
+        assert(Header(out, "Content-length") == "8" && Header(out, "ETag") != etag);
+        assert(out.substr(out.size() - 8) == "version2");
+    }
+    response.closeFile();
+    std::cout << "Pass!" << std::endl;
+}
+
+// 负缓存已满时，.gz 兄弟文件不存在的查询仍被缓存，压缩结果照常命中，不反复提交压缩
+void TestGzipNegativeFull() {
+    std::cout << "Testing gzip variants with a full negative cache..." << std::endl;
+    Buffer buffer;
+    HttpResponse response;
+    std::string text;
+    for (int i = 0; i < 300; i++) { text += "line " + std::to_string(i) + "\n"; }
+    std::ofstream(dir + "/notes.txt") << text;
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    FileCache* files = FileCache::Instance();
+    for (size_t i = 0; i < FileCache::MAX_NEGATIVE; i++) {
+        files->get("/scan-" + std::to_string(i) + ".php");
+    }
+    uint64_t loads = files->loads();
+    files->get("/scan-extra.php");
+    files->get("/scan-extra.php");
+    assert(files->loads() == loads + 2);    // 已达上限，不再缓存
+
+    std::string path = "/notes.txt";
+    auto get = [&]() {
+        response.init(dir, path, true, 200);
+        response.setAcceptGzip(true);
+        response.makeResponse(buffer);
+        return Assemble(response, buffer);
+    };
+    uint64_t jobs = Compressor::Instance()->jobs();
+    assert(Header(get(), "Content-Encoding").empty());
+    for (int i = 0; i < 100 && Compressor::Instance()->jobs() == jobs; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    loads = files->loads();
+    for (int i = 0; i < 3; i++) {
+        assert(Header(get(), "Content-Encoding") == "gzip");
+    }
+    assert(Compressor::Instance()->jobs() == jobs + 1);
+    assert(files->loads() == loads);
+    response.closeFile();
+    std::cout << "Pass!" << std::endl;
+}
+
+// 缓存命中后，生成 200 响应(包括小文件 Blob 与映射的大文件)不应有堆分配
+void TestNoAlloc() {
+    std::cout << "Testing allocations per response..." << std::endl;
+    Buffer buffer(4096);
+    HttpResponse response;
+    std::string paths[] = {"/index.html", "/style.css"};
+    const int N = 100000;
+    for (std::string& path : paths) {
+        response.init(dir, path, true, 200);    // 预热缓存与 path_/srcDir_ 的容量
+        response.makeResponse(buffer);
+        buffer.RetrieveAll();
+
+        long before = allocs;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < N; i++) {
+            response.init(dir, path, true, 200);
+            response.makeResponse(buffer);
+            buffer.RetrieveAll();
+        }
+        double ns = std::chrono::duration<double, std::nano>(
+                std::chrono::steady_clock::now() - start).count() / N;
+        long n = allocs - before;
+        std::cout << path << ": " << ns << " ns/response, " << n << " allocations" << std::endl;
+        assert(n == 0);
+    }
+    response.closeFile();
+    std::cout << "Pass!" << std::endl;
+}
+
+int main() {
+    char tmpl[] = "/tmp/httpresponse_XXXXXX";
+    dir = mkdtemp(tmpl);
+    std::ofstream(dir + "/index.html") << "hello";
+    std::ofstream(dir + "/style.css") << std::string(100000, 'a');
+    std::ofstream(dir + "/404.html") << "not found";
+    mkdir((dir + "/a").c_str(), 0755);
+    ContentCache::Instance()->init(1024 * 1024);
+    Compressor::Instance()->init();
+    FileCache::Instance()->init(dir, ContentCache::MAX_OBJECT);
+
+    TestAppendDecimal();
+    TestHeaders();
+    TestConditional();
+    TestRange();
+    TestGzip();
+    TestErrorPages();
+    TestNonCanonicalPath();
+    TestGzipNegativeFull();
+    TestNoAlloc();
+
+    Compressor::Instance()->close();
+    FileCache::Instance()->close();
+    system(("rm -rf " + dir).c_str());
+    std::cout << "All HttpResponse tests passed!" << std::endl;
+    return 0;
+}
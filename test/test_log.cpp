@@ -12,6 +12,9 @@
 #include <sstream>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <string_view>
+#include <chrono>
+#include <sys/time.h>
 
 // 辅助函数：检查文件是否存在
 bool FileExists(const std::string& path) {
@@ -278,6 +281,169 @@ void TestDynamicLevelChange() {
     std::cout << "动态切换日志级别测试完成" << std::endl;
 }
 
+// 测试10：延迟格式化，写日志线程格式化(DEFERRED)与二进制文件离线还原(BINARY)的输出应与 printf 一致
+static std::string LogDeferredSamples() {
+    const char* name = "Alice";
+    std::string_view method("GET /index.html", 3);
+    char* nullStr = nullptr;
+    size_t bytes = 1234567;
+    unsigned long long big = 18446744073709551615ULL;
+    std::string expect;
+    char line[512];
+    for (int i = 0; i < 3; i++) {
+        LOG_INFO("User %s (ID: %d) has balance: %.2f", name, 12345 + i, 99.99 * i);
+        snprintf(line, sizeof(line), "User %s (ID: %d) has balance: %.2f\n", name, 12345 + i, 99.99 * i);
+        expect += line;
+    }
+    LOG_WARN("[%.*s] %-6s|%5d|%x|%zu|%llu|%c|100%%", (int)method.size(), method.data(), "ab", -42, 255u, bytes, big, 'z');
+    snprintf(line, sizeof(line), "[%.*s] %-6s|%5d|%x|%zu|%llu|%c|100%%\n", (int)method.size(), method.data(), "ab", -42, 255u, bytes, big, 'z');
+    expect += line;
+    LOG_ERROR("null:%s, %08.3f, %ld, %e", nullStr, 3.14159, -7L, 1e-9);
+    snprintf(line, sizeof(line), "null:%s, %08.3f, %ld, %e\n", "(null)", 3.14159, -7L, 1e-9);
+    expect += line;
+    LOG_DEBUG("no args");
+    expect += "no args\n";
+    return expect;
+}
+
+// 去掉每行的时间与级别前缀
+static std::string StripPrefix(const std::string& text) {
+    std::string out;
+    std::istringstream in(text);
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t pos = line.find("]: ");
+        if (pos == std::string::npos) { pos = line.find("] : "); }
+        out += line.substr(line.find(": ", pos) + 2) + "\n";
+    }
+    return out;
+}
+
+void TestDeferredMode() {
+    std::cout << "\n========== 测试10: 延迟格式化 ==========" << std::endl;
+    time_t now = time(nullptr);
+    struct tm* t = localtime(&now);
+    char day[32];
+    snprintf(day, sizeof(day), "/%04d_%02d_%02d", t->tm_year + 1900, t->tm_mon + 1, t->tm_mday);
+
+    system("rm -rf ./test_logs/deferred ./test_logs/binary");
+    Log::Instance().init(0, "./test_logs/deferred", ".log", 1024, Log::DEFERRED);
+    assert(Log::Instance().IsDeferred());
+    std::string expect = LogDeferredSamples();
+    Log::Instance().flush();
+    std::string text = ReadFile(std::string("./test_logs/deferred") + day + ".log");
+    assert(StripPrefix(text) == expect);
+    assert(text.find("[warn] : [GET] ab    |  -42|ff|1234567|") != std::string::npos);
+
+    Log::Instance().init(0, "./test_logs/binary", ".blog", 1024, Log::BINARY);
+    LogDeferredSamples();
+    Log::Instance().flush();
+    std::string data = ReadFile(std::string("./test_logs/binary") + day + ".blog");
+    std::string decoded;
+    assert(LogRecord::Decode(data.data(), data.size(), decoded));
+    assert(StripPrefix(decoded) == expect);
+
+    Log::Instance().init(0, "./test_logs/deferred", ".log", 1024);
+    assert(!Log::Instance().IsDeferred());
+    std::cout << "✓ 两种延迟格式化的输出与 printf 一致" << std::endl;
+}
+
+// 测试11：行首时间戳的开销，逐行 localtime_r + snprintf 与按秒缓存对比，再看 1M 行异步写入的整体开销
+void BenchTimestamp() {
+    std::cout << "\n========== 测试11: 时间戳性能 ==========" << std::endl;
+    const int N = 1000000;
+    char out[64];
+    size_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < N; i++) {
+        struct timeval now;
+        gettimeofday(&now, nullptr);
+        time_t sec = now.tv_sec;
+        struct tm t;
+        localtime_r(&sec, &t);
+        sink += snprintf(out, sizeof(out), "%d-%02d-%02d %02d:%02d:%02d.%06ld ", t.tm_year + 1900,
+                t.tm_mon + 1, t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec, now.tv_usec);
+    }
+    auto mid = std::chrono::steady_clock::now();
+    for (int i = 0; i < N; i++) {
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        LogTime::Format(now.tv_sec, now.tv_nsec / 1000, out);
+        sink += out[25];
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::cout << "逐行格式化: " << std::chrono::duration<double, std::nano>(mid - start).count() / N
+              << " ns/行, 按秒缓存: " << std::chrono::duration<double, std::nano>(end - mid).count() / N
+              << " ns/行 (" << sink % 10 << ")" << std::endl;
+
+    Log::Instance().init(1, "./test_logs/bench", ".log", 8192);
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < N; i++) {
+        LOG_INFO("Client[%d](%s:%d) in, userCount:%d", i, "127.0.0.1", 40000, i);
+    }
+    Log::Instance().flush();
+    end = std::chrono::steady_clock::now();
+    double secs = std::chrono::duration<double>(end - start).count();
+    std::cout << "异步写入 " << N << " 行: " << secs * 1e9 / N << " ns/行, "
+              << N / secs / 1e6 << "M 行/秒" << std::endl;
+}
+
+// 测试12：环满时的处理策略；不论是否丢弃，写入的行数 + 丢弃/抽样计数应等于提交的行数
+static int CountLines(const std::string& dir, const char* marker) {
+    std::string files = dir + "/*";
+    std::string cmd = "cat " + files + " 2>/dev/null | grep -c '" + marker + "'";
+    FILE* fp = popen(cmd.c_str(), "r");
+    int n = 0;
+    if (fp) {
+        if (fscanf(fp, "%d", &n) != 1) { n = 0; }
+        pclose(fp);
+    }
+    return n;
+}
+
+void TestOverflowPolicy() {
+    std::cout << "\n========== 测试12: 环满处理策略 ==========" << std::endl;
+    const int THREADS = 4, N = 50000;
+    struct Case { Log::OVERFLOW_POLICY policy; const char* dir; };
+    const Case cases[] = {
+        {Log::DROP_NEWEST, "./test_logs/overflow_drop"},
+        {Log::SAMPLE, "./test_logs/overflow_sample"},
+        {Log::DROP_BY_LEVEL, "./test_logs/overflow_level"},
+    };
+    for (const Case& c : cases) {
+        system(("rm -rf " + std::string(c.dir)).c_str());
+        Log::Instance().init(0, c.dir, ".log", 1);    // 最小的环(64KB)，更容易写满
+        Log::Instance().SetOverflowPolicy(c.policy, 4);
+        uint64_t dropped = Log::Instance().DroppedLines(), sampled = Log::Instance().SampledLines();
+        std::vector<std::thread> threads;
+        for (int t = 0; t < THREADS; t++) {
+            threads.emplace_back([t] {
+                for (int i = 0; i < N; i++) {
+                    if (i % 10 == 0) {
+                        LOG_WARN("Overflow warn %d-%d", t, i);
+                    }
+                    else {
+                        LOG_INFO("Overflow info %d-%d, padding padding padding padding", t, i);
+                    }
+                }
+            });
+        }
+        for (auto& th : threads) { th.join(); }
+        Log::Instance().flush();
+        dropped = Log::Instance().DroppedLines() - dropped;
+        sampled = Log::Instance().SampledLines() - sampled;
+        int written = CountLines(c.dir, "Overflow ");
+        std::cout << "策略 " << c.policy << ": 写入 " << written << ", 丢弃 " << dropped
+                  << ", 抽样略过 " << sampled << std::endl;
+        assert(written + dropped + sampled == static_cast<uint64_t>(THREADS * N));
+        if (c.policy == Log::DROP_BY_LEVEL) {
+            assert(CountLines(c.dir, "Overflow warn") == THREADS * N / 10);
+        }
+    }
+    Log::Instance().SetOverflowPolicy(Log::BLOCK);
+    std::cout << "✓ 计数与写入行数一致" << std::endl;
+}
+
 int main() {
     std::cout << "========================================" << std::endl;
     std::cout << "    Log 模块全面测试开始" << std::endl;
@@ -286,7 +452,7 @@ int main() {
     // 创建测试日志目录
     system("mkdir -p ./test_logs/sync ./test_logs/async ./test_logs/level "
            "./test_logs/file_mgmt ./test_logs/multithread ./test_logs/format "
-           "./test_logs/dynamic");
+           "./test_logs/dynamic ./test_logs/bench");
     
     try {
         TestBlockDeque();
@@ -298,6 +464,9 @@ int main() {
         TestMultiThread();
         TestLogFormatting();
         TestDynamicLevelChange();
+        TestDeferredMode();
+        BenchTimestamp();
+        TestOverflowPolicy();
         
         std::cout << "\n========================================" << std::endl;
         std::cout << "    所有测试完成！" << std::endl;
@@ -1,6 +1,7 @@
 #include "../code/log/log.h"
 #include "../code/pool/threadpool.h"
 #include <features.h>
+#include <iostream>
 
 
 void TestLog() {
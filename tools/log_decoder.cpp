@@ -0,0 +1,49 @@
+/*
+把 BINARY 模式写出的二进制日志还原成文本日志
+用法: ./log_decoder file...     还原结果输出到标准输出，不给文件时读标准输入
+*/
+#include <cstdio>
+#include <string>
+#include "log/logrecord.h"
+
+static bool ReadAll(FILE* fp, std::string& data) {
+    char buf[64 * 1024];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+        data.append(buf, n);
+    }
+    return !ferror(fp);
+}
+
+static int DecodeFile(const char* name, FILE* fp) {
+    std::string data, text;
+    if (!ReadAll(fp, data)) {
+        fprintf(stderr, "%s: read error\n", name);
+        return 1;
+    }
+    bool ok = LogRecord::Decode(data.data(), data.size(), text);
+    fwrite(text.data(), 1, text.size(), stdout);
+    if (!ok) {
+        fprintf(stderr, "%s: not a binary log or truncated\n", name);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        return DecodeFile("stdin", stdin);
+    }
+    int ret = 0;
+    for (int i = 1; i < argc; i++) {
+        FILE* fp = fopen(argv[i], "rb");
+        if (fp == nullptr) {
+            perror(argv[i]);
+            ret = 1;
+            continue;
+        }
+        ret |= DecodeFile(argv[i], fp);
+        fclose(fp);
+    }
+    return ret;
+}